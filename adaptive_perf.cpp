@@ -0,0 +1,139 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: adaptive_perf.cpp
+// DATE: Fall 2021
+// DESC: Small-map crossover benchmark used to pick AdaptiveMap's
+//       thresholds. For map sizes from 1 to 16K keys it times
+//       building a map from scratch, lookups (half hits, half
+//       misses), and erase/insert churn, for ArrayMap, HashMap, and
+//       AdaptiveMap. To run from the command line use:
+//          ./adaptive_perf > adaptive.dat
+//---------------------------------------------------------------------------
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "arrayseq.h"
+#include "arraymap.h"
+#include "hashmap.h"
+#include "adaptivemap.h"
+
+
+using namespace std;
+using namespace std::chrono;
+
+
+// test parameters
+const int max_size = 16384;
+const int total_keys = 1 << 21;
+
+
+// simple deterministic pseudo-random numbers (64-bit LCG)
+unsigned long long next_random(unsigned long long& state)
+{
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 33;
+}
+
+// nanoseconds per key to build maps of n keys from scratch
+template<typename MapT>
+double time_build(const ArraySeq<int,0>& keys, int n)
+{
+  int maps = total_keys / n;
+  long total = 0;
+  auto t0 = high_resolution_clock::now();
+  for (int r = 0; r < maps; ++r) {
+    MapT m;
+    for (int i = 0; i < n; ++i)
+      m.insert(keys[i], i);
+    total += m.size();
+  }
+  auto t1 = high_resolution_clock::now();
+  if (total != (long) maps * n)
+    cerr << "build lost a key" << endl;
+  return duration_cast<nanoseconds>(t1 - t0).count() / (double) total;
+}
+
+// nanoseconds per lookup in a map of n keys (half the probes hit)
+template<typename MapT>
+double time_lookup(const ArraySeq<int,0>& keys, int n, unsigned long long& state)
+{
+  MapT m;
+  for (int i = 0; i < n; ++i)
+    m.insert(keys[i], i);
+  const int probes = 1 << 20;
+  ArraySeq<int,0> probe_keys;
+  probe_keys.reserve(probes);
+  for (int i = 0; i < probes; ++i)
+    probe_keys.insert(keys[next_random(state) % (2 * n)], i);
+  int found = 0;
+  auto t0 = high_resolution_clock::now();
+  for (int key : probe_keys)
+    found += m.contains(key) ? 1 : 0;
+  auto t1 = high_resolution_clock::now();
+  if (found == 0)
+    cerr << "lookups found nothing" << endl;
+  return duration_cast<nanoseconds>(t1 - t0).count() / (double) probes;
+}
+
+// nanoseconds per erase+insert pair in a map holding n keys
+template<typename MapT>
+double time_churn(const ArraySeq<int,0>& keys, int n)
+{
+  MapT m;
+  for (int i = 0; i < n; ++i)
+    m.insert(keys[i], i);
+  const int ops = 1 << 18;
+  // erase the oldest key, insert the next one
+  auto t0 = high_resolution_clock::now();
+  for (int i = 0; i < ops; ++i) {
+    m.erase(keys[i % (2 * n)]);
+    m.insert(keys[(i + n) % (2 * n)], i);
+  }
+  auto t1 = high_resolution_clock::now();
+  if (m.size() != n)
+    cerr << "churn lost a key" << endl;
+  return duration_cast<nanoseconds>(t1 - t0).count() / (double) ops;
+}
+
+
+int main()
+{
+  cout << fixed << showpoint;
+  cout << setprecision(2);
+
+  cout << "# All times in nanoseconds per operation" << endl;
+  cout << "# Column 1 = number of keys" << endl;
+  cout << "# Column 2 = arraymap build" << endl;
+  cout << "# Column 3 = hashmap build" << endl;
+  cout << "# Column 4 = adaptive map build" << endl;
+  cout << "# Column 5 = arraymap contains" << endl;
+  cout << "# Column 6 = hashmap contains" << endl;
+  cout << "# Column 7 = adaptive map contains" << endl;
+  cout << "# Column 8 = arraymap erase + insert" << endl;
+  cout << "# Column 9 = hashmap erase + insert" << endl;
+  cout << "# Column 10 = adaptive map erase + insert" << endl;
+
+  // 2 * max_size distinct random keys
+  unsigned long long state = 223;
+  ArraySeq<int,0> keys;
+  keys.reserve(2 * max_size);
+  for (int i = 0; i < 2 * max_size; ++i)
+    keys.insert(i, i);
+  for (int i = 2 * max_size - 1; i > 0; --i)
+    std::swap(keys.unchecked_at(i), keys.unchecked_at(next_random(state) % (i + 1)));
+
+  for (int n = 1; n <= max_size; n *= 2) {
+    cout << n
+         << " " << time_build<ArrayMap<int,int>>(keys, n)
+         << " " << time_build<HashMap<int,int>>(keys, n)
+         << " " << time_build<AdaptiveMap<int,int>>(keys, n)
+         << " " << time_lookup<ArrayMap<int,int>>(keys, n, state)
+         << " " << time_lookup<HashMap<int,int>>(keys, n, state)
+         << " " << time_lookup<AdaptiveMap<int,int>>(keys, n, state)
+         << " " << time_churn<ArrayMap<int,int>>(keys, n)
+         << " " << time_churn<HashMap<int,int>>(keys, n)
+         << " " << time_churn<AdaptiveMap<int,int>>(keys, n)
+         << endl;
+  }
+}
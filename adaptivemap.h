@@ -0,0 +1,452 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: adaptivemap.h
+// DATE: Fall 2021
+// DESC: Map that changes representation with its size. While it holds
+//       at most Promote pairs it is an ArrayMap (a flat, SIMD-scanned
+//       array with no per-pair allocation, the fastest map for a
+//       handful of keys). Inserting past Promote pairs moves every
+//       pair into a Large map (HashMap by default; any ordered Map
+//       such as BinSearchMap also works), and erasing down below
+//       Demote pairs moves them back. Demote is well below Promote
+//       so that a map hovering around one size doesn't convert back
+//       and forth on every insert and erase. The default thresholds
+//       come from the crossover benchmark in adaptive_perf.cpp.
+//---------------------------------------------------------------------------
+
+#ifndef ADAPTIVEMAP_H
+#define ADAPTIVEMAP_H
+
+#include <utility>
+#include "map.h"
+#include "arrayseq.h"
+#include "arraymap.h"
+#include "hashmap.h"
+
+
+template<typename K, typename V,
+         template<typename,typename> class Large = HashMap,
+         int Promote = 128, int Demote = 32>
+class AdaptiveMap final : public Map<K,V>
+{
+  static_assert(0 <= Demote && Demote < Promote,
+                "AdaptiveMap requires 0 <= Demote < Promote");
+
+public:
+
+  // Default constructor
+  AdaptiveMap();
+
+  // Copy constructor
+  AdaptiveMap(const AdaptiveMap& rhs);
+
+  // Move constructor
+  AdaptiveMap(AdaptiveMap&& rhs);
+
+  // Copy assignment operator
+  AdaptiveMap& operator=(const AdaptiveMap& rhs);
+
+  // Move assignment operator
+  AdaptiveMap& operator=(AdaptiveMap&& rhs);
+
+  // Destructor
+  ~AdaptiveMap();
+
+  // Returns the number of key-value pairs in the map
+  int size() const;
+
+  // Tests if the map is empty
+  bool empty() const;
+
+  // Allows values associated with a key to be updated. Throws
+  // out_of_range if the given key is not in the collection.
+  V& operator[](const K& key);
+
+  // Returns the value for a given key. Throws out_of_range if the
+  // given key is not in the collection.
+  const V& operator[](const K& key) const;
+
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws.
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
+  // Extends the collection by adding the given key-value
+  // pair. Assumes the key being added is not present in the
+  // collection. Insert does not check if the key is present.
+  void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
+
+  // Shrinks the collection by removing the key-value pair with the
+  // given key. Does not modify the collection if the collection does
+  // not contain the key. Throws out_of_range if the given key is not
+  // in the collection.
+  void erase(const K& key);
+
+  // Returns true if the key is in the collection, and false
+  // otherwise.
+  bool contains(const K& key) const;
+
+  // Returns the keys k in the collection such that k1 <= k <= k2
+  ArraySeq<K> find_keys(const K& k1, const K& k2) const;
+
+  // Returns the keys in the collection in ascending sorted order.
+  ArraySeq<K> sorted_keys() const;
+
+  // Promotes the map at most once for the whole batch, then hands
+  // the batch to whichever map holds the pairs
+  void insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values);
+
+  // Hands the batch to whichever map holds the pairs
+  ArraySeq<bool> contains_batch(const ArraySeq<K>& batch_keys) const;
+
+  // Calls visit(key, value) on every pair, in the order of whichever
+  // map holds them (see ArrayMap and Large), without allocating.
+  // visit may modify the values, but must not otherwise modify the
+  // map.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+  // Returns true if the pairs are currently stored in the Large map
+  bool promoted() const;
+
+private:
+
+  // the pairs while there are at most Promote of them
+  ArrayMap<K,V> small;
+
+  // the pairs once there are more than Promote of them (nullptr
+  // while the map is small)
+  Large<K,V>* large = nullptr;
+
+  // helper to move every pair from one map into another (empty) map
+  // in a single pass over the source (the keys are copied, since the
+  // source's keys are const, and the values moved)
+  template<typename From, typename To>
+  static void move_pairs(From& from, To& to){
+    from.for_each([&to](const K& key, V& value){
+      to.insert(K(key), std::move(value));
+    });
+  }
+
+  // helper for the single-lookup inserts: promotes the map if
+  // inserting the key would take the ArrayMap past Promote pairs
+  void promote_for(const K& key){
+    if(!large && small.size() >= Promote && !small.contains(key)){
+      promote();
+    }
+  }
+
+  // helper to switch to the Large map
+  void promote(){
+    large = new Large<K,V>;
+    move_pairs(small, *large);
+    small = ArrayMap<K,V>();
+  }
+
+  // helper to switch back to the ArrayMap
+  void demote(){
+    move_pairs(*large, small);
+    delete large;
+    large = nullptr;
+  }
+};
+
+
+template<typename K, typename V, template<typename,typename> class Large,
+         int Promote, int Demote>
+AdaptiveMap<K,V,Large,Promote,Demote>::AdaptiveMap()
+{
+  return;
+}
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  AdaptiveMap<K,V,Large,Promote,Demote>::AdaptiveMap(const AdaptiveMap& rhs){
+    *this = rhs;
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  AdaptiveMap<K,V,Large,Promote,Demote>::AdaptiveMap(AdaptiveMap&& rhs){
+    *this = std::move(rhs);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  AdaptiveMap<K,V,Large,Promote,Demote>&
+  AdaptiveMap<K,V,Large,Promote,Demote>::operator=(const AdaptiveMap& rhs){
+    if(this != &rhs){
+      delete large;
+      large = rhs.large ? new Large<K,V>(*rhs.large) : nullptr;
+      small = rhs.small;
+    }
+    return *this;
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  AdaptiveMap<K,V,Large,Promote,Demote>&
+  AdaptiveMap<K,V,Large,Promote,Demote>::operator=(AdaptiveMap&& rhs){
+    if(this != &rhs){
+      delete large;
+      large = rhs.large;
+      rhs.large = nullptr;
+      small = std::move(rhs.small);
+    }
+    return *this;
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  AdaptiveMap<K,V,Large,Promote,Demote>::~AdaptiveMap(){
+    delete large;
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  int AdaptiveMap<K,V,Large,Promote,Demote>::size() const{
+    return large ? large->size() : small.size();
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  bool AdaptiveMap<K,V,Large,Promote,Demote>::empty() const{
+    return size() == 0;
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  V& AdaptiveMap<K,V,Large,Promote,Demote>::operator[](const K& key){
+    return large ? (*large)[key] : small[key];
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  const V& AdaptiveMap<K,V,Large,Promote,Demote>::operator[](const K& key) const{
+    const Large<K,V>* l = large;
+    return l ? (*l)[key] : small[key];
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  V* AdaptiveMap<K,V,Large,Promote,Demote>::find(const K& key) noexcept{
+    return large ? large->find(key) : small.find(key);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  const V* AdaptiveMap<K,V,Large,Promote,Demote>::find(const K& key) const noexcept{
+    const Large<K,V>* l = large;
+    return l ? l->find(key) : small.find(key);
+  }
+
+  // Promotes the map once the ArrayMap would hold more than Promote
+  // pairs
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::insert(const K& key, const V& value){
+    if(!large && small.size() >= Promote){
+      promote();
+    }
+    if(large){
+      large->insert(key, value);
+    }
+    else {
+      small.insert(key, value);
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::insert(K&& key, V&& value){
+    if(!large && small.size() >= Promote){
+      promote();
+    }
+    if(large){
+      large->insert(std::move(key), std::move(value));
+    }
+    else {
+      small.insert(std::move(key), std::move(value));
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  std::pair<V*,bool> AdaptiveMap<K,V,Large,Promote,Demote>::try_insert(const K& key, const V& value){
+    promote_for(key);
+    return large ? large->try_insert(key, value) : small.try_insert(key, value);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  bool AdaptiveMap<K,V,Large,Promote,Demote>::insert_or_assign(const K& key, const V& value){
+    promote_for(key);
+    return large ? large->insert_or_assign(key, value) : small.insert_or_assign(key, value);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  std::pair<V*,bool> AdaptiveMap<K,V,Large,Promote,Demote>::try_insert(K&& key, V&& value){
+    promote_for(key);
+    if(large){
+      return large->try_insert(std::move(key), std::move(value));
+    }
+    return small.try_insert(std::move(key), std::move(value));
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  bool AdaptiveMap<K,V,Large,Promote,Demote>::insert_or_assign(K&& key, V&& value){
+    promote_for(key);
+    if(large){
+      return large->insert_or_assign(std::move(key), std::move(value));
+    }
+    return small.insert_or_assign(std::move(key), std::move(value));
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> AdaptiveMap<K,V,Large,Promote,Demote>::emplace(KK&& key, Args&&... args){
+    promote_for(key);
+    if(large){
+      return large->emplace(std::forward<KK>(key), std::forward<Args>(args)...);
+    }
+    return small.emplace(std::forward<KK>(key), std::forward<Args>(args)...);
+  }
+
+  // Demotes the map once the Large map holds fewer than Demote pairs
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::erase(const K& key){
+    if(!large){
+      small.erase(key);
+      return;
+    }
+    large->erase(key);
+    if(large->size() < Demote){
+      demote();
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  bool AdaptiveMap<K,V,Large,Promote,Demote>::contains(const K& key) const{
+    return large ? large->contains(key) : small.contains(key);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  ArraySeq<K> AdaptiveMap<K,V,Large,Promote,Demote>::find_keys(const K& k1, const K& k2) const{
+    return large ? large->find_keys(k1, k2) : small.find_keys(k1, k2);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  ArraySeq<K> AdaptiveMap<K,V,Large,Promote,Demote>::sorted_keys() const{
+    return large ? large->sorted_keys() : small.sorted_keys();
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::insert_batch(const ArraySeq<K>& batch_keys,
+                                                           const ArraySeq<V>& batch_values){
+    this->check_batch(batch_keys, batch_values);
+    if(!large && small.size() + batch_keys.size() > Promote){
+      promote();
+    }
+    if(large){
+      large->insert_batch(batch_keys, batch_values);
+    }
+    else {
+      small.insert_batch(batch_keys, batch_values);
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  ArraySeq<bool> AdaptiveMap<K,V,Large,Promote,Demote>::contains_batch(const ArraySeq<K>& batch_keys) const{
+    return large ? large->contains_batch(batch_keys) : small.contains_batch(batch_keys);
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  bool AdaptiveMap<K,V,Large,Promote,Demote>::promoted() const{
+    return large != nullptr;
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  template<typename F>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::for_each(F visit){
+    if(large){
+      large->for_each(visit);
+    }
+    else {
+      small.for_each(visit);
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  template<typename F>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::for_each(F visit) const{
+    const Large<K,V>* l = large;
+    if(l){
+      l->for_each(visit);
+    }
+    else {
+      small.for_each(visit);
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  template<typename F>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::for_each_in_range(const K& k1, const K& k2, F visit){
+    if(large){
+      large->for_each_in_range(k1, k2, visit);
+    }
+    else {
+      small.for_each_in_range(k1, k2, visit);
+    }
+  }
+
+  template<typename K, typename V, template<typename,typename> class Large,
+           int Promote, int Demote>
+  template<typename F>
+  void AdaptiveMap<K,V,Large,Promote,Demote>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+    const Large<K,V>* l = large;
+    if(l){
+      l->for_each_in_range(k1, k2, visit);
+    }
+    else {
+      small.for_each_in_range(k1, k2, visit);
+    }
+  }
+
+#endif
@@ -2,6 +2,8 @@
 // NAME:Dominic MacIsaac
 // DATE: Fall 2021
 // DESC: Map with array sequence to store key value pairs
+//       Ordered queries are served from a sorted copy of the keys
+//       that is rebuilt only after a write (see sortedkeycache.h).
 //---------------------------------------------------------------------------
 
 #ifndef ARRAYMAP_H
@@ -9,10 +11,13 @@
 
 #include "map.h"
 #include "arrayseq.h"
+#include "seqview.h"
+#include "memoryusage.h"
+#include "sortedkeycache.h"
 
 
 template<typename K, typename V>
-class ArrayMap : public Map<K,V>
+class ArrayMap final : public Map<K,V>
 {
 public:
 
@@ -30,10 +35,31 @@ public:
   // given key is not in the collection. 
   const V& operator[](const K& key) const;
 
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws.
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
   // Extends the collection by adding the given key-value
   // pair. Assumes the key being added is not present in the
   // collection. Insert does not check if the key is present.
   void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
 
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
@@ -51,22 +77,80 @@ public:
   // Returns the keys in the collection in ascending sorted order.
   ArraySeq<K> sorted_keys() const;  
 
+  // Returns a view of all the keys in ascending sorted order, without
+  // copying them. The view is valid until the map is modified.
+  SeqView<K> sorted_view() const;
+
+  // Calls visit(key, value) on every pair in storage order (not
+  // sorted), without allocating. visit may modify the values, but
+  // must not otherwise modify the map.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2
+  // (still a scan of every pair)
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+  // Appends the whole batch after growing each array at most once
+  void insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values);
+
+  // Returns the bytes the map uses (see memoryusage.h). Unused
+  // capacity of the key and value arrays is slack, and the sorted key
+  // cache is metadata.
+  MemoryUsage memory_usage() const;
+
 private:
 
-  // implemented as a resizable array of (key-value) pairs
-  ArraySeq<std::pair<K,V>> seq;
+  // implemented as two parallel resizable arrays (keys[i] is the key
+  // for vals[i]) so that key scans only touch key memory and can be
+  // vectorized by ArraySeq::index_of
+  ArraySeq<K> keys;
+  ArraySeq<V> vals;
+
+  // sorted copy of the keys for the ordered queries
+  mutable SortedKeyCache<K> key_cache;
+
+  // helper for the single-lookup inserts: returns the key's value
+  // if the key is present, and otherwise appends the pair (key,
+  // make_value()). The key is only moved from (if it is an rvalue)
+  // when the pair is appended.
+  template<typename KK, typename F>
+  std::pair<V*,bool> find_or_insert(KK&& key, F make_value){
+    int i = keys.index_of(key);
+    if(i >= 0){
+      return {&vals.unchecked_at(i), false};
+    }
+    keys.insert(std::forward<KK>(key), keys.size());
+    vals.insert(make_value(), vals.size());
+    key_cache.invalidate();
+    return {&vals.unchecked_at(vals.size() - 1), true};
+  }
+
+  // helper to bring key_cache up to date
+  void update_key_cache() const{
+    key_cache.update(keys.size(), [this](FlatSeq<K>& sorted){
+      for(const K& key : keys){
+        sorted.insert(key, sorted.size());
+      }
+    });
+  }
 
 };
 
 template<typename K, typename V>
 int ArrayMap<K,V>::size() const{
-  return seq.size();
+  return keys.size();
 }
 
   // Tests if the map is empty
   template<typename K, typename V>
   bool ArrayMap<K,V>::empty() const{
-    if(seq.size()==0){ 
+    if(keys.size()==0){ 
       return true;
     }
     return false;
@@ -76,12 +160,9 @@ int ArrayMap<K,V>::size() const{
   // out_of_range if the given key is not in the collection.
   template<typename K, typename V>
   V& ArrayMap<K,V>::operator[](const K& key){
-    int i = 0;
-    while(i < seq.size()){
-      if(seq[i].first == key){
-        return seq[i].second;
-      }
-      ++i;
+    V* value = find(key);
+    if(value != nullptr){
+      return *value;
     }
     throw std:: out_of_range("ArrayMap<K,V>::operator[](const K& key");
   }
@@ -90,15 +171,23 @@ int ArrayMap<K,V>::size() const{
   // given key is not in the collection. 
   template<typename K, typename V>
   const V& ArrayMap<K,V>::operator[](const K& key) const{
-    int i = 0;
-    while(i < seq.size()){
-      if(seq[i].first == key){
-        return seq[i].second;
-      }
-      ++i;
+    const V* value = find(key);
+    if(value != nullptr){
+      return *value;
     }
     throw std:: out_of_range("ArrayMap<K,V>::operator[](const K& key");
-    
+  }
+
+  template<typename K, typename V>
+  V* ArrayMap<K,V>::find(const K& key) noexcept{
+    int i = keys.index_of(key);
+    return i >= 0 ? &vals.unchecked_at(i) : nullptr;
+  }
+
+  template<typename K, typename V>
+  const V* ArrayMap<K,V>::find(const K& key) const noexcept{
+    int i = keys.index_of(key);
+    return i >= 0 ? &vals.unchecked_at(i) : nullptr;
   }
 
   // Extends the collection by adding the given key-value
@@ -106,23 +195,66 @@ int ArrayMap<K,V>::size() const{
   // collection. Insert does not check if the key is present.
   template<typename K, typename V>
   void ArrayMap<K,V>::insert(const K& key, const V& value){
-    seq.insert(std::pair(key,value), seq.size());
+    keys.insert(key, keys.size());
+    vals.insert(value, vals.size());
+    key_cache.invalidate();
     return;
   }
 
+  template<typename K, typename V>
+  void ArrayMap<K,V>::insert(K&& key, V&& value){
+    keys.insert(std::move(key), keys.size());
+    vals.insert(std::move(value), vals.size());
+    key_cache.invalidate();
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> ArrayMap<K,V>::try_insert(const K& key, const V& value){
+    return find_or_insert(key, [&]() -> const V& {return value;});
+  }
+
+  template<typename K, typename V>
+  bool ArrayMap<K,V>::insert_or_assign(const K& key, const V& value){
+    std::pair<V*,bool> result = find_or_insert(key, [&]() -> const V& {return value;});
+    if(!result.second){
+      *result.first = value;
+    }
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> ArrayMap<K,V>::try_insert(K&& key, V&& value){
+    return find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+  }
+
+  template<typename K, typename V>
+  bool ArrayMap<K,V>::insert_or_assign(K&& key, V&& value){
+    std::pair<V*,bool> result = find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+    if(!result.second){
+      *result.first = std::move(value);
+    }
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> ArrayMap<K,V>::emplace(KK&& key, Args&&... args){
+    return find_or_insert(std::forward<KK>(key), [&]() {return V(std::forward<Args>(args)...);});
+  }
+
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
   // not contain the key. Throws out_of_range if the given key is not
   // in the collection.
   template<typename K, typename V>
   void ArrayMap<K,V>::erase(const K& key){
-    int i = 0;
-    while(i < seq.size()){
-      if(seq[i].first == key){
-        seq.erase(i);
-        return;
-      }
-      ++i;
+    int i = keys.index_of(key);
+    if(i >= 0){
+      // the pairs are unordered, so fill the hole with the last pair
+      keys.erase_unordered(i);
+      vals.erase_unordered(i);
+      key_cache.invalidate();
+      return;
     }
     throw std:: out_of_range("ArrayMap<K,V>::operator[](const K& key");
   }
@@ -131,45 +263,86 @@ int ArrayMap<K,V>::size() const{
   // otherwise.
   template<typename K, typename V>
   bool ArrayMap<K,V>:: contains(const K& key) const{
-    int i = 0;
-    while(i < seq.size()){
-      if(seq[i].first == key){
-        return true;
-      }
-      ++i;
-    }
-    return false;
+    return keys.contains(key);
   }
 
   // Returns the keys k in the collection such that k1 <= k <= k2
   template<typename K, typename V>
   ArraySeq<K> ArrayMap<K,V>::find_keys(const K& k1, const K& k2) const{
-    ArraySeq<K> keyList;
+    update_key_cache();
+    return key_cache.range(k1, k2);
+  }
 
-    int i = 0;
-    while(i < seq.size()){
-      if(seq[i].first >= k1 && seq[i].first <= k2){
-        keyList.insert(seq[i].first, keyList.size());
-      }
-      ++i;
+  // Returns the keys in the collection in ascending sorted order.
+  template<typename K, typename V>
+  ArraySeq<K> ArrayMap<K,V>::sorted_keys() const{
+    update_key_cache();
+    return key_cache.all();
+  }
+
+  template<typename K, typename V>
+  SeqView<K> ArrayMap<K,V>::sorted_view() const{
+    update_key_cache();
+    return key_cache.view();
+  }
+
+  template<typename K, typename V>
+  void ArrayMap<K,V>::insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values){
+    this->check_batch(batch_keys, batch_values);
+    keys.reserve(keys.size() + batch_keys.size());
+    vals.reserve(vals.size() + batch_values.size());
+    for(int i = 0; i < batch_keys.size(); i++){
+      keys.insert(batch_keys.unchecked_at(i), keys.size());
+      vals.insert(batch_values.unchecked_at(i), vals.size());
     }
+    key_cache.invalidate();
+  }
 
-    return keyList;
+  template<typename K, typename V>
+  template<typename F>
+  void ArrayMap<K,V>::for_each(F visit){
+    for(int i = 0; i < keys.size(); i++){
+      visit(static_cast<const K&>(keys.unchecked_at(i)), vals.unchecked_at(i));
+    }
   }
 
-  // Returns the keys in the collection in ascending sorted order.
   template<typename K, typename V>
-  ArraySeq<K> ArrayMap<K,V>::sorted_keys() const{
-    ArraySeq<K> keyList;
-   
-    int i = 0;
-    while(i < seq.size()){
-      keyList.insert(seq[i].first, keyList.size());
-      ++i;
+  template<typename F>
+  void ArrayMap<K,V>::for_each(F visit) const{
+    for(int i = 0; i < keys.size(); i++){
+      visit(keys.unchecked_at(i), vals.unchecked_at(i));
     }
+  }
 
-    keyList.merge_sort();
-    return keyList;
+  template<typename K, typename V>
+  template<typename F>
+  void ArrayMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit){
+    for(int i = 0; i < keys.size(); i++){
+      const K& key = keys.unchecked_at(i);
+      if(!(key < k1) && !(k2 < key)){
+        visit(key, vals.unchecked_at(i));
+      }
+    }
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void ArrayMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+    for(int i = 0; i < keys.size(); i++){
+      const K& key = keys.unchecked_at(i);
+      if(!(key < k1) && !(k2 < key)){
+        visit(key, vals.unchecked_at(i));
+      }
+    }
+  }
+
+  template<typename K, typename V>
+  MemoryUsage ArrayMap<K,V>::memory_usage() const{
+    MemoryUsage usage = keys.memory_usage();
+    usage += vals.memory_usage();
+    usage += key_cache.memory_usage().as_metadata();
+    usage.metadata += sizeof(*this) - sizeof(keys) - sizeof(vals) - sizeof(key_cache);
+    return usage;
   }
 
 #endif
@@ -12,27 +12,55 @@
 
 #include <stdexcept>
 #include <ostream>
+#include <algorithm>
+#include <utility>
+#include <array>
+#include <memory>
+#include <memory_resource>
 #include "sequence.h"
+#include "simdsearch.h"
+#include "memoryusage.h"
+#include "opcounters.h"
 
 
+// Default number of elements an ArraySeq stores inline (inside the
+// object, without a heap allocation): as many as fit in one 64-byte
+// cache line, up to 16.
 template<typename T>
-class ArraySeq : public Sequence<T>
+constexpr int default_inline_size =
+  sizeof(T) > 64 ? 0 : (64 / sizeof(T) > 16 ? 16 : 64 / sizeof(T));
+
+
+// Array-based sequence. The first N elements are stored inline; once
+// the sequence grows past N it spills to a heap array that doubles in
+// size. Use N = 0 for large, long-lived sequences (e.g., map storage)
+// where the inline elements would only be wasted space. The heap
+// array comes from a std::pmr::memory_resource (the default resource
+// unless one is given), so a sequence can live in an arena or pool.
+template<typename T, int N = default_inline_size<T>>
+class ArraySeq final : public Sequence<T>
 {
 public:
 
   // Default constructor
   ArraySeq();
 
-  // Copy constructor
+  // Creates an empty sequence that allocates from the given memory
+  // resource
+  explicit ArraySeq(std::pmr::memory_resource* resource);
+
+  // Copy constructor (like the std::pmr containers, the copy
+  // allocates from the default resource)
   ArraySeq(const ArraySeq& rhs);
 
-  // Move constructor
+  // Move constructor (takes over rhs's memory resource)
   ArraySeq(ArraySeq&& rhs);
 
   // Copy assignment operator
   ArraySeq& operator=(const ArraySeq& rhs);
 
-  // Move assignment operator
+  // Move assignment operator (the elements are moved one by one if
+  // the two sequences' memory resources differ)
   ArraySeq& operator=(ArraySeq&& rhs);
 
  friend std::ostream & operator << (std::ostream &out, const ArraySeq& rhs){
@@ -65,27 +93,80 @@ public:
   // sequence. Throws out_of_range if index is invalid.
   virtual const T& operator[](int index) const;
 
+  // Returns the element at the index without bounds checking. The
+  // index must be in [0, size()).
+  T& unchecked_at(int index);
+  const T& unchecked_at(int index) const;
+
+  // Returns a pointer to the underlying contiguous array. The pointer
+  // is invalidated when the sequence grows or is reassigned.
+  T* data();
+  const T* data() const;
+
+  // Raw pointer iterators over [0, size()), usable with the STL
+  // algorithms and range-based for loops
+  T* begin();
+  T* end();
+  const T* begin() const;
+  const T* end() const;
+
   // Extends the sequence by inserting the element at the given
   // index. Throws out_of_range if the index is invalid.
   virtual void insert(const T& elem, int index);
+  virtual void insert(T&& elem, int index);
 
   // Shrinks the sequence by removing the element at the index in the
   // sequence. Throws out_of_range if index is invalid.
   virtual void erase(int index);
 
+  // Removes the element at the index by moving the last element into
+  // its place: O(1), but does not keep the order of the remaining
+  // elements. Throws out_of_range if index is invalid.
+  void erase_unordered(int index);
+
+  // Removes every element for which pred(elem) is true, keeping the
+  // order of the rest, in one compacting pass. Returns the number of
+  // elements removed.
+  template<typename Pred>
+  int erase_if(Pred pred);
+
   // Returns true if the element is in the sequence, and false
   // otherwise.
   virtual bool contains(const T& elem) const;
 
+  // Returns the index of the first occurrence of the element in the
+  // sequence, or -1 if the element is not in the sequence. Integer
+  // elements are scanned with SIMD compares (see simdsearch.h).
+  int index_of(const T& elem) const;
+
   // Sorts the elements in the sequence using less than equal (<=)
   // operator. (Not implemented in HW-3)
   virtual void sort(); 
   virtual void merge_sort();
   virtual void quick_sort();
+
+  // Ensures the sequence can hold at least n elements without
+  // growing again
+  void reserve(int n);
+
+  // Appends the n elements starting at first, growing the array at
+  // most once and copying them in one pass
+  void append(const T* first, int n);
+
+  // Returns the memory resource the sequence allocates from
+  std::pmr::memory_resource* memory_resource() const;
+
+  // Returns the bytes the sequence uses (see memoryusage.h). Unused
+  // inline slots and unused heap capacity are slack.
+  MemoryUsage memory_usage() const;
   
 private:
 
-  // resizable array
+  // where the heap array is allocated
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+  // resizable array (points at inline_array until the sequence grows
+  // past N elements)
   T* array = nullptr;
 
   // size of list
@@ -94,30 +175,83 @@ private:
   // max capacity of the array
   int capacity = 0;
 
+  // storage for the first N elements
+  std::array<T,N> inline_array;
+
+  // first heap capacity when growing a sequence without inline
+  // storage
+  static const int initial_capacity = 8;
+
+  // true if the elements are currently stored in inline_array
+  bool is_inline() const{
+    return N > 0 && array == inline_array.data();
+  }
+
+  // helpers to get and give back a heap array of n elements (every
+  // slot holds a default-constructed T, as with new T[n])
+  T* allocate_array(int n){
+    T* first = static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+    try {
+      std::uninitialized_default_construct_n(first, n);
+    }
+    catch(...) {
+      resource->deallocate(first, n * sizeof(T), alignof(T));
+      throw;
+    }
+    return first;
+  }
+
+  void free_array(T* first, int n){
+    std::destroy_n(first, n);
+    resource->deallocate(first, n * sizeof(T), alignof(T));
+  }
+
+  // helper to move the elements into a heap array of the given
+  // capacity
+  void reallocate(int new_capacity){
+    T* temp = allocate_array(new_capacity);
+    std::move(array, array + count, temp);
+    if(!is_inline() && array != nullptr){
+      free_array(array, capacity);
+    }
+    array = temp;
+    capacity = new_capacity;
+  }
+
+  // helper for both inserts (copies or moves elem into place)
+  template<typename U>
+  void insert_elem(U&& elem, int index){
+    if (index < 0 || index > count){
+      throw std:: out_of_range("ArraySeq <T>:: insert(const T& elem, int index)");
+    }
+    if(count == capacity){
+      this->resize();
+    }
+    std::move_backward(array + index, array + count, array + count + 1);
+    OP_COUNT(moves, count - index);
+    array[index] = std::forward<U>(elem);
+    ++count;
+  }
+
   // helper to double the capacity of the array
   void resize(){
-    if(capacity == 0)
-    {
-    array = new T[1];
-    ++capacity;
+    if(capacity == 0){
+      reallocate(initial_capacity);
     }
     else {
-      capacity=capacity*2;
-      T* temp = new T[capacity];
-       for(int i = 0; i < count; i++){
-         temp[i] = array[i];
-       }
-    delete [] array;
-    array = temp;
+      reallocate(capacity*2);
     }
   }
   
   // helper to delete the array list (called by destructor and copy
-  // constructor)
+  // constructor); leaves the sequence empty, using inline storage
   void make_empty(){
-    delete[] array;
+    if(!is_inline() && array != nullptr){
+      free_array(array, capacity);
+    }
+    array = N > 0 ? inline_array.data() : nullptr;
     count = 0;
-    capacity = 0;
+    capacity = N;
   }
 
   void merge_sort(int start, int end){
@@ -174,74 +308,103 @@ private:
   }
 };
 
+// ArraySeq without inline storage (used where a one-parameter
+// sequence template is expected, e.g., as a map's backing store)
 template<typename T>
-ArraySeq<T>::ArraySeq()
+using FlatSeq = ArraySeq<T,0>;
+
+
+template<typename T, int N>
+ArraySeq<T,N>::ArraySeq()
 {
+   make_empty();
    return;
 }
 
+template<typename T, int N>
+ArraySeq<T,N>::ArraySeq(std::pmr::memory_resource* resource)
+  : resource(resource)
+{
+   make_empty();
+}
+
  // Copy constructor
  
- template<typename T>
-  ArraySeq<T>::ArraySeq(const ArraySeq& rhs){
+ template<typename T, int N>
+  ArraySeq<T,N>::ArraySeq(const ArraySeq& rhs){
     *this = rhs;
     return;
   }
 
   // Move constructor
-  template<typename T>
-  ArraySeq<T>::ArraySeq(ArraySeq&& rhs){
+  template<typename T, int N>
+  ArraySeq<T,N>::ArraySeq(ArraySeq&& rhs)
+    : resource(rhs.resource){
+    make_empty();
     *this = std::move(rhs);
   }
 
   // Copy assignment operator
-  template<typename T>
-  ArraySeq<T>& ArraySeq<T>::operator=(const ArraySeq& rhs){
+  template<typename T, int N>
+  ArraySeq<T,N>& ArraySeq<T,N>::operator=(const ArraySeq& rhs){
     if(this != &rhs){
       this->make_empty();
-      this->capacity = rhs.capacity;
-      this->count = rhs.count;
-      T* temp = new T[this->capacity];
-      this->array = temp;
-      for(int i = 0; i<this->count; i++){
-        this->array[i] = rhs.array[i];
+      if(rhs.count > N){
+        this->array = allocate_array(rhs.capacity);
+        this->capacity = rhs.capacity;
       }
+      this->count = rhs.count;
+      std::copy(rhs.array, rhs.array + rhs.count, this->array);
     }
     return *this;
   }
 
   // Move assignment operator
-  template<typename T>
-  ArraySeq<T>& ArraySeq<T>::operator=(ArraySeq&& rhs){
+  template<typename T, int N>
+  ArraySeq<T,N>& ArraySeq<T,N>::operator=(ArraySeq&& rhs){
     if(this != &rhs){
       this->make_empty();
-      this->capacity = rhs.capacity;
-      this->count = rhs.count;
-      this->array = rhs.array;
-      rhs.array = nullptr;
-      rhs.count = 0;
-      rhs.capacity = 0;
+      if(rhs.is_inline()){
+        // inline elements can't be stolen, so move them one by one
+        std::move(rhs.array, rhs.array + rhs.count, this->array);
+        this->count = rhs.count;
+        rhs.count = 0;
+      }
+      else if(!resource->is_equal(*rhs.resource)){
+        // nor can an array this sequence's resource didn't allocate
+        this->reserve(rhs.count);
+        std::move(rhs.array, rhs.array + rhs.count, this->array);
+        this->count = rhs.count;
+        rhs.make_empty();
+      }
+      else {
+        this->capacity = rhs.capacity;
+        this->count = rhs.count;
+        this->array = rhs.array;
+        rhs.array = nullptr;
+        rhs.make_empty();
+      }
     }
 
     return *this;
   }
 
   // Destructor
-  template<typename T>
-  ArraySeq<T>::~ArraySeq(){
+  template<typename T, int N>
+  ArraySeq<T,N>::~ArraySeq(){
     this->make_empty();
     return;
   }
   
   // Returns the number of elements in the sequence
-  template<typename T>
-  int ArraySeq<T>::size() const{
+  template<typename T, int N>
+  int ArraySeq<T,N>::size() const{
     return count;
   }
 
   // Tests if the sequence is empty
-  template<typename T>
-  bool ArraySeq<T>::empty() const{
+  template<typename T, int N>
+  bool ArraySeq<T,N>::empty() const{
     if(count == 0){
       return true;
     }
@@ -250,8 +413,8 @@ ArraySeq<T>::ArraySeq()
 
   // Returns a reference to the element at the index in the
   // sequence. Throws out_of_range if index is invalid.
-  template<typename T>
-  T& ArraySeq<T>::operator[](int index){
+  template<typename T, int N>
+  T& ArraySeq<T,N>::operator[](int index){
     if (index < 0 || index >= count){
       throw std:: out_of_range("ArraySeq <T>:: operator[](int index)");
     }
@@ -261,8 +424,8 @@ ArraySeq<T>::ArraySeq()
 
   // Returns a constant address to the element at the index in the
   // sequence. Throws out_of_range if index is invalid.
-  template<typename T>
-  const T& ArraySeq<T>::operator[](int index) const{
+  template<typename T, int N>
+  const T& ArraySeq<T,N>::operator[](int index) const{
     if (index < 0 || index >= count){
       throw std:: out_of_range("const T& ArraySeq <T>:: operator[](int index)");
     }
@@ -270,76 +433,106 @@ ArraySeq<T>::ArraySeq()
     return array[index];
   }
 
+  template<typename T, int N>
+  T& ArraySeq<T,N>::unchecked_at(int index){
+    return array[index];
+  }
+
+  template<typename T, int N>
+  const T& ArraySeq<T,N>::unchecked_at(int index) const{
+    return array[index];
+  }
+
+  template<typename T, int N>
+  T* ArraySeq<T,N>::data(){
+    return array;
+  }
+
+  template<typename T, int N>
+  const T* ArraySeq<T,N>::data() const{
+    return array;
+  }
+
+  template<typename T, int N>
+  T* ArraySeq<T,N>::begin(){
+    return array;
+  }
+
+  template<typename T, int N>
+  T* ArraySeq<T,N>::end(){
+    return array + count;
+  }
+
+  template<typename T, int N>
+  const T* ArraySeq<T,N>::begin() const{
+    return array;
+  }
+
+  template<typename T, int N>
+  const T* ArraySeq<T,N>::end() const{
+    return array + count;
+  }
+
   // Extends the sequence by inserting the element at the given
   // index. Throws out_of_range if the index is invalid.
-  template<typename T>
-  void ArraySeq<T>::insert(const T& elem, int index){
-   
-    if(capacity == 0 and index == 0){
-      this->resize();
-    }
+  template<typename T, int N>
+  void ArraySeq<T,N>::insert(const T& elem, int index){
+    insert_elem(elem, index);
+  }
 
-    if(count == capacity){
-      this->resize();
-    }
+  template<typename T, int N>
+  void ArraySeq<T,N>::insert(T&& elem, int index){
+    insert_elem(std::move(elem), index);
+  }
 
-    if (index < 0 || index >= capacity){
-      throw std:: out_of_range("ArraySeq <T>:: insert(const T& elem, int index)");
-      return;
-    }
-    
-    for(int i = count; i>index; i--){
-      array[i] = array[i-1];
+  
+  template<typename T, int N>
+  void ArraySeq<T,N>::erase(int index){
+    if (index < 0 || index >= count){
+      throw std:: out_of_range("ArraySeq <T>:: erase(int index)");
     }
-
-    array[index] = elem;
-    ++count;
+    std::move(array + index + 1, array + count, array + index);
+    OP_COUNT(moves, count - index - 1);
+    --count;
     return;
   }
 
-  
-  template<typename T>
-  void ArraySeq<T>::erase(int index){
-    
-    
+  template<typename T, int N>
+  void ArraySeq<T,N>::erase_unordered(int index){
     if (index < 0 || index >= count){
-      throw std:: out_of_range("ArraySeq <T>:: erase(int index)");
+      throw std:: out_of_range("ArraySeq <T>:: erase_unordered(int index)");
     }
-   
-    T* temp = new T[1];
-    
-    
-    if(capacity == 1){
-      array[0] = temp[0];
-      --count;
-      delete [] temp;
-      return;
+    if(index != count - 1){
+      array[index] = std::move(array[count - 1]);
     }
+    --count;
+  }
 
-   
-    for(int i = index; i < count; i++){
-      array[i] = array[i+1];
-    }
+  template<typename T, int N>
+  template<typename Pred>
+  int ArraySeq<T,N>::erase_if(Pred pred){
+    T* last = std::remove_if(array, array + count, pred);
+    int removed = (array + count) - last;
+    count -= removed;
+    return removed;
+  }
 
-    --count;
-    delete [] temp;
-    return;
+  template<typename T, int N>
+  bool ArraySeq<T,N>::contains(const T& elem) const{
+    return index_of(elem) >= 0;
   }
 
-  template<typename T>
-  bool ArraySeq<T>::contains(const T& elem) const{
-    for(int i = 0; i < count; i++){
-      if(elem == array[i]){
-        return true;
-      }
-    }
-    return false;
+  template<typename T, int N>
+  int ArraySeq<T,N>::index_of(const T& elem) const{
+    int index = linear_find(array, count, elem);
+    OP_COUNT(comparisons, index < 0 ? count : index + 1);
+    return index;
   }
 
 
 
-template<typename T>
-void ArraySeq<T>::sort()
+template<typename T, int N>
+void ArraySeq<T,N>::sort()
 {
   // TODO: saved for future assignment
 }
@@ -349,15 +542,44 @@ void ArraySeq<T>::sort()
 //       discussed in class and specified in the homework assignment.
 
 
-template<typename T>
-void ArraySeq<T>::merge_sort(){
+template<typename T, int N>
+void ArraySeq<T,N>::merge_sort(){
   this->merge_sort(0,this->size()-1);
 }
 
-template<typename T>
-void ArraySeq<T>::quick_sort(){
+template<typename T, int N>
+void ArraySeq<T,N>::quick_sort(){
   this->quick_sort(0,this->size()-1);
 }
 
+template<typename T, int N>
+void ArraySeq<T,N>::reserve(int n){
+  if(n > capacity){
+    reallocate(n);
+  }
+}
+
+template<typename T, int N>
+std::pmr::memory_resource* ArraySeq<T,N>::memory_resource() const{
+  return resource;
+}
+
+template<typename T, int N>
+MemoryUsage ArraySeq<T,N>::memory_usage() const{
+  int slots = N + (is_inline() ? 0 : capacity);
+  MemoryUsage usage;
+  usage.payload = (long) count * sizeof(T);
+  usage.slack = (long) (slots - count) * sizeof(T);
+  usage.metadata = sizeof(*this) - (long) N * sizeof(T);
+  return usage;
+}
+
+template<typename T, int N>
+void ArraySeq<T,N>::append(const T* first, int n){
+  reserve(count + n);
+  std::copy(first, first + n, array + count);
+  count += n;
+}
+
 
 #endif
@@ -2,17 +2,40 @@
 // NAME:Dominic MacIsaac
 // DATE:Fall 2021
 // DESC: Binary Search map that uses an array map and binary search function to story key value pairs in order
+//       Keys and values are kept in separate parallel sequences.
+//       The sequence type is a template parameter: FlatSeq (a plain
+//       ArraySeq) by default, or TieredSeq for O(sqrt n) inserts and
+//       erases in the middle of large maps. The search strategy over
+//       the sorted keys is also a template parameter (see
+//       searchpolicy.h and learnedindex.h).
+//
+//       Inserts and erases are not applied to the sorted arrays right
+//       away. They are recorded in a write buffer of sorted runs
+//       whose sizes grow like a binary counter (a log-structured
+//       merge design), and the runs are merged into the arrays in one
+//       linear pass once they reach half the array size. Loading n
+//       keys therefore costs O(n log n) instead of O(n^2) element
+//       moves. Lookups check the buffer (newest run first) and then
+//       the arrays. Const queries never merge the buffer (they merge
+//       it into their results instead), so they don't move any pairs
+//       and can run concurrently.
 //---------------------------------------------------------------------------
 
 #ifndef BINSEARCHMAP_H
 #define BINSEARCHMAP_H
 
+#include <algorithm>
 #include "map.h"
 #include "arrayseq.h"
+#include "tieredseq.h"
+#include "seqview.h"
+#include "searchpolicy.h"
+#include "memoryusage.h"
 
 
-template<typename K, typename V>
-class BinSearchMap : public Map<K,V>
+template<typename K, typename V, template<typename> class Seq = FlatSeq,
+         typename Search = BinarySearch>
+class BinSearchMap final : public Map<K,V>
 {
 public:
 
@@ -30,10 +53,31 @@ public:
   // given key is not in the collection. 
   const V& operator[](const K& key) const;
 
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws.
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
   // Extends the collection by adding the given key-value
   // pair. Assumes the key being added is not present in the
   // collection. Insert does not check if the key is present.
   void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
 
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
@@ -51,55 +95,339 @@ public:
   // Returns the keys in the collection in ascending sorted order.
   ArraySeq<K> sorted_keys() const;  
 
+  // Sorts the batch and merges it with the sorted arrays in one
+  // O(n + m log m) pass, bypassing the write buffer
+  void insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values);
+
+  // Sorts the batch and removes its keys from the sorted arrays in
+  // one O(n + m log m) pass (see Map for the error behaviour)
+  void erase_batch(const ArraySeq<K>& batch_keys);
+
+  // Searches for the keys in sorted order, each search starting where
+  // the previous one ended
+  ArraySeq<bool> contains_batch(const ArraySeq<K>& batch_keys) const;
+
+  // Returns a view of the keys k in the collection such that k1 <= k
+  // <= k2, in ascending order, without copying them. The view points
+  // into the map's key array and is valid until the map is modified.
+  // The write buffer is merged first (so this is not const), then
+  // O(log n). Requires a contiguous sequence type (FlatSeq).
+  SeqView<K> find_range(const K& k1, const K& k2);
+
+  // Returns a view of the values of the keys in find_range(k1, k2),
+  // in the same order
+  SeqView<V> value_range(const K& k1, const K& k2);
+
+  // Returns a view of all the keys in ascending sorted order (see
+  // find_range)
+  SeqView<K> sorted_view();
+
+  // Calls visit(key, value) on every pair in ascending key order,
+  // without allocating. visit may modify the values, but must not
+  // otherwise modify the map. The non-const version merges the write
+  // buffer first; the const version merges it into the walk.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2
+  // (O(log n + k) once the write buffer is merged)
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+  // Merges all buffered inserts and erases into the sorted arrays.
+  // Invalidates references to values.
+  void flush();
+
+  // Replaces the contents with the pairs (new_keys[i],
+  // new_values[i]), which must be in ascending key order without
+  // repeated keys. O(n): nothing is searched or sorted (e.g., for
+  // loading a snapshot). Throws out_of_range if the views differ in
+  // size.
+  void assign_sorted(SeqView<K> new_keys, SeqView<V> new_values);
+
+  // Returns the search strategy, up to date with the map's contents
+  // (e.g., for a LearnedSearch's index_bytes()). Merges the write
+  // buffer first.
+  const Search& search_policy();
+
+  // Returns the bytes the map uses (see memoryusage.h), without
+  // merging the write buffer. Buffered entries count as payload (even
+  // ones that replace or erase a sorted pair) plus their live flags as
+  // overhead, and the search policy's index (if it has one) is
+  // metadata.
+  MemoryUsage memory_usage() const;
+
 private:
 
-  // If the key is in the collection, bin_search returns true and
-  // provides the key's index within the array sequence (via the index
-  // output parameter). If the key is not in the collection,
-  // bin_search returns false and provides the last index checked by
-  // the binary search algorithm. 
-  bool bin_search(const K& key, int& index) const{
-    if(seq.size() == 0){index = 0; return false;}
-    int start = 0;
-    int mid = 0;
-    int end = seq.size()-1;
+  // a buffered insert (live) or erase (tombstone) of a key
+  struct Delta {
+    K key;
+    V value;
+    bool live;
+    bool operator==(const Delta& rhs) const {return key == rhs.key;}
+    bool operator<(const Delta& rhs) const {return key < rhs.key;}
+  };
+
+  // maximum number of buffer runs (run r holds at most 2^r entries)
+  static constexpr int max_runs = 32;
+
+  // the buffer is always allowed to grow to this many entries before
+  // it is merged, even when the arrays are smaller
+  static constexpr int min_delta = 32;
+
+  // Returns the newest buffered entry for the key, or nullptr if the
+  // key has no buffered insert or erase
+  const Delta* find_delta(const K& key) const{
+    if(delta_count == 0){
+      return nullptr;
+    }
+    for(int r = 0; r < max_runs; r++){
+      const Delta* first = runs[r].data();
+      const Delta* last = first + runs[r].size();
+      const Delta* it = std::lower_bound(first, last, key, key_less);
+      OP_COUNT(comparisons, it != last ? 1 : 0);
+      if(it != last && it->key == key){
+        return it;
+      }
+    }
+    return nullptr;
+  }
 
-    while(start <= end){
+  Delta* find_delta(const K& key){
+    return const_cast<Delta*>(static_cast<const BinSearchMap*>(this)->find_delta(key));
+  }
 
-      mid = (end-start)/2 + start;
+  // orders buffered entries against keys (for the run searches,
+  // counting each comparison like the array searches do)
+  static bool key_less(const Delta& d, const K& key){
+    OP_COUNT(comparisons, 1);
+    return d.key < key;
+  }
+  static bool less_key(const K& key, const Delta& d){
+    OP_COUNT(comparisons, 1);
+    return key < d.key;
+  }
 
-      if(key == seq[mid].first){
-        index = mid;
-        return true;
-      }
+  // helper to buffer an insert or erase. Like incrementing a binary
+  // counter, full runs are merged into the new entry until an empty
+  // run is found, so each entry is moved O(log n) times.
+  // Returns the address of the entry's value, wherever it ended up
+  // (nullptr for a tombstone that was merged away). The key and value
+  // are moved into the entry if they are rvalues.
+  template<typename KK, typename VV>
+  V* add_delta(KK&& key, VV&& value, bool live){
+    FlatSeq<Delta> carry;
+    carry.insert(Delta{std::forward<KK>(key), std::forward<VV>(value), live}, 0);
+    int r = 0;
+    int at = 0;
+    while(!runs[r].empty()){
+      carry = merge_runs(runs[r], carry, at);
+      runs[r] = FlatSeq<Delta>();
+      ++r;
+    }
+    runs[r] = std::move(carry);
+    int top = r;
+    delta_count = 0;
+    for(r = 0; r < max_runs; r++){
+      delta_count += runs[r].size();
+    }
+    if(delta_count >= std::max(min_delta, keys.size() / 2)){
+      // the key may have been moved into the entry, so keep a copy to
+      // find it again after the merge (once per flush, not per insert)
+      K flushed = runs[top].unchecked_at(at).key;
+      flush();
+      int i = 0;
+      return bin_search(flushed, i) ? &vals.unchecked_at(i) : nullptr;
+    }
+    return &runs[top].unchecked_at(at).value;
+  }
+
+  // helper for the single-lookup inserts: returns the key's value
+  // if the key is present, and otherwise buffers the pair (key,
+  // make_value())
+  template<typename KK, typename F>
+  std::pair<V*,bool> find_or_insert(KK&& key, F make_value){
+    V* value = find(key);
+    if(value != nullptr){
+      return {value, false};
+    }
+    ++count;
+    return {add_delta(std::forward<KK>(key), make_value(), true), true};
+  }
 
-      if(key < seq[mid].first){
-        end = mid - 1;
+  // helper for both inserts: a repeated key replaces the pair (as it
+  // would once the buffer is merged), so it is only counted once and
+  // size() is the same before and after a merge
+  template<typename KK, typename VV>
+  void insert_pair(KK&& key, VV&& value){
+    if(!contains(key)){
+      ++count;
+    }
+    add_delta(std::forward<KK>(key), std::forward<VV>(value), true);
+  }
+
+  // Merges two sorted runs, moving their entries (both are discarded
+  // afterwards). For keys in both runs only the entry from the newer
+  // run is kept. at is the index of an entry of newer, and is updated
+  // to that entry's index in the merged run.
+  static FlatSeq<Delta> merge_runs(FlatSeq<Delta>& older,
+                                   FlatSeq<Delta>& newer, int& at){
+    FlatSeq<Delta> merged;
+    merged.reserve(older.size() + newer.size());
+    int i = 0, j = 0, new_at = at;
+    while(i < older.size() || j < newer.size()){
+      OP_COUNT(comparisons, i < older.size() && j < newer.size() ? 1 : 0);
+      OP_COUNT(moves, 1);
+      if(j == newer.size() ||
+         (i < older.size() && older.unchecked_at(i).key < newer.unchecked_at(j).key)){
+        merged.insert(std::move(older.unchecked_at(i++)), merged.size());
+      }
+      else {
+        OP_COUNT(comparisons, i < older.size() ? 1 : 0);
+        if(i < older.size() && !(newer.unchecked_at(j).key < older.unchecked_at(i).key)){
+          ++i;
+        }
+        if(j == at){
+          new_at = merged.size();
+        }
+        merged.insert(std::move(newer.unchecked_at(j++)), merged.size());
       }
+    }
+    at = new_at;
+    return merged;
+  }
+
+  // helper for the non-const for_each and for_each_in_range: calls
+  // visit(key, value) on the pairs at indexes lo..hi-1 (the buffer
+  // must be merged)
+  template<typename F>
+  void walk(int lo, int hi, F&& visit){
+    for(int i = lo; i < hi; i++){
+      visit(static_cast<const K&>(keys.unchecked_at(i)), vals.unchecked_at(i));
+    }
+  }
 
-      if(key > seq[mid].first){
-        start = mid + 1;
+  // helper for the const queries, which leave the buffer alone: calls
+  // visit(key, value) on the pairs with k1 <= key <= k2 (no bound if
+  // k1 or k2 is nullptr) in ascending key order, merging the sorted
+  // arrays and the buffer runs as it goes. The newest entry for a
+  // key wins, and a tombstone hides the key. O((k + d) log n) for k
+  // pairs and d buffered entries in range.
+  template<typename F>
+  void walk_merged(const K* k1, const K* k2, F&& visit) const{
+    int i = k1 == nullptr ? 0 : lower_bound(*k1);
+    int end = k2 == nullptr ? keys.size() : upper_bound(*k2);
+    // the runs' entries in range, newest run first
+    const Delta* next[max_runs];
+    const Delta* last[max_runs];
+    int used = 0;
+    for(int r = 0; r < max_runs && delta_count > 0; r++){
+      const Delta* first = runs[r].data();
+      const Delta* stop = first + runs[r].size();
+      if(k1 != nullptr){
+        first = std::lower_bound(first, stop, *k1, key_less);
+      }
+      if(k2 != nullptr){
+        stop = std::upper_bound(first, stop, *k2, less_key);
+      }
+      if(first != stop){
+        next[used] = first;
+        last[used] = stop;
+        used++;
+      }
+    }
+    while(true){
+      // the smallest buffered key (from the newest run that has it)
+      const Delta* newest = nullptr;
+      for(int u = 0; u < used; u++){
+        if(next[u] != last[u] && (newest == nullptr || next[u]->key < newest->key)){
+          newest = next[u];
+        }
       }
+      while(i < end && (newest == nullptr || keys.unchecked_at(i) < newest->key)){
+        visit(keys.unchecked_at(i), vals.unchecked_at(i));
+        i++;
+      }
+      if(newest == nullptr){
+        return;
+      }
+      // the entry replaces or erases the array's pair
+      if(i < end && !(newest->key < keys.unchecked_at(i))){
+        i++;
+      }
+      if(newest->live){
+        visit(newest->key, newest->value);
+      }
+      // step past the key in every run (older entries are hidden by
+      // the newest one)
+      for(int u = 0; u < used; u++){
+        if(next[u] != last[u] && !(newest->key < next[u]->key)){
+          ++next[u];
+        }
+      }
+    }
+  }
+
+  // If the key is in the collection, bin_search returns true and
+  // provides the key's index within the array sequence (via the index
+  // output parameter). If the key is not in the collection,
+  // bin_search returns false and provides the index the key would be
+  // inserted at to keep the keys sorted.
+  bool bin_search(const K& key, int& index) const{
+    index = lower_bound(key);
+    return index < keys.size() && keys.unchecked_at(index) == key;
+  }
 
+  // Returns the index of the first key not less than the given key
+  // (size() if there is none)
+  int lower_bound(const K& key) const{
+    return search.lower_bound(keys, key);
+  }
+
+  // Returns the index of the first key greater than the given key
+  // (size() if there is none)
+  int upper_bound(const K& key) const{
+    int i = lower_bound(key);
+    if(i < keys.size() && !(key < keys.unchecked_at(i))){
+      ++i;
     }
-    index = mid;
-    return false;
+    return i;
   }
   
-  // implemented as a resizable array of (key-value) pairs
-  ArraySeq<std::pair<K,V>> seq;
+  // implemented as two parallel sequences sorted by key (vals[i] is
+  // the value for keys[i]). Keeping the keys dense means the binary
+  // search only touches key memory, and inserts and erases shift keys
+  // and values separately.
+  Seq<K> keys;
+  Seq<V> vals;
+
+  // write buffer: runs[0] holds the newest entries
+  FlatSeq<Delta> runs[max_runs];
+
+  // number of entries in the write buffer
+  int delta_count = 0;
+
+  // number of key-value pairs in the map
+  int count = 0;
+
+  // strategy for searching the sorted keys (see searchpolicy.h)
+  Search search;
 
 };
 
-template<typename K, typename V>
-int BinSearchMap<K,V>::size() const{
-   return seq.size();
+template<typename K, typename V, template<typename> class Seq, typename Search>
+int BinSearchMap<K,V,Seq,Search>::size() const{
+   return count;
 }
 
   // Tests if the map is empty
-  template<typename K, typename V>
-  bool BinSearchMap<K,V>::empty() const{
-     if(seq.size()==0){ 
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  bool BinSearchMap<K,V,Seq,Search>::empty() const{
+     if(count==0){ 
       return true;
     }
     return false;
@@ -107,53 +435,99 @@ int BinSearchMap<K,V>::size() const{
 
   // Allows values associated with a key to be updated. Throws
   // out_of_range if the given key is not in the collection.
-  template<typename K, typename V>
-  V& BinSearchMap<K,V>::operator[](const K& key){
-    int i = 0;
-    if(bin_search(key,i)){return seq[i].second;}
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  V& BinSearchMap<K,V,Seq,Search>::operator[](const K& key){
+    V* value = find(key);
+    if(value != nullptr){return *value;}
     throw std:: out_of_range("ArrayMap<K,V>::operator[](const K& key");
 
   }
 
   // Returns the value for a given key. Throws out_of_range if the
   // given key is not in the collection. 
-  template<typename K, typename V>
-  const V& BinSearchMap<K,V>::operator[](const K& key) const{
-    int i = 0;
-    if(bin_search(key,i)){return seq[i].second;}
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  const V& BinSearchMap<K,V,Seq,Search>::operator[](const K& key) const{
+    const V* value = find(key);
+    if(value != nullptr){return *value;}
     throw std:: out_of_range("ArrayMap<K,V>::operator[](const K& key");
 
   }
 
+  // Checks the write buffer (a tombstone means the key was erased),
+  // then the sorted arrays
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  V* BinSearchMap<K,V,Seq,Search>::find(const K& key) noexcept{
+    Delta* d = find_delta(key);
+    if(d != nullptr){return d->live ? &d->value : nullptr;}
+    int i = 0;
+    return bin_search(key,i) ? &vals.unchecked_at(i) : nullptr;
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  const V* BinSearchMap<K,V,Seq,Search>::find(const K& key) const noexcept{
+    const Delta* d = find_delta(key);
+    if(d != nullptr){return d->live ? &d->value : nullptr;}
+    int i = 0;
+    return bin_search(key,i) ? &vals.unchecked_at(i) : nullptr;
+  }
+
   // Extends the collection by adding the given key-value
   // pair. Assumes the key being added is not present in the
   // collection. Insert does not check if the key is present.
-  template<typename K, typename V>
-  void BinSearchMap<K,V>::insert(const K& key, const V& value){
-    if(this->empty()){
-      seq.insert(std::pair(key,value),0);
-      return;
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::insert(const K& key, const V& value){
+    insert_pair(key, value);
+    return;
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::insert(K&& key, V&& value){
+    insert_pair(std::move(key), std::move(value));
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  std::pair<V*,bool> BinSearchMap<K,V,Seq,Search>::try_insert(const K& key, const V& value){
+    return find_or_insert(key, [&]() -> const V& {return value;});
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  bool BinSearchMap<K,V,Seq,Search>::insert_or_assign(const K& key, const V& value){
+    std::pair<V*,bool> result = find_or_insert(key, [&]() -> const V& {return value;});
+    if(!result.second){
+      *result.first = value;
     }
-    int i = 0;
-    this->bin_search(key, i);
-    if(seq[i].first > key){
-      seq.insert(std::pair(key,value),i);
-      return;
+    return result.second;
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  std::pair<V*,bool> BinSearchMap<K,V,Seq,Search>::try_insert(K&& key, V&& value){
+    return find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  bool BinSearchMap<K,V,Seq,Search>::insert_or_assign(K&& key, V&& value){
+    std::pair<V*,bool> result = find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+    if(!result.second){
+      *result.first = std::move(value);
     }
-    seq.insert(std::pair(key,value),i+1);
+    return result.second;
+  }
 
-    return;
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> BinSearchMap<K,V,Seq,Search>::emplace(KK&& key, Args&&... args){
+    return find_or_insert(std::forward<KK>(key), [&]() {return V(std::forward<Args>(args)...);});
   }
 
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
   // not contain the key. Throws out_of_range if the given key is not
   // in the collection.
-  template<typename K, typename V>
-  void BinSearchMap<K,V>::erase(const K& key){
-    int i = 0;
-    if(bin_search(key,i)){
-      seq.erase(i);
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::erase(const K& key){
+    if(contains(key)){
+      --count;
+      add_delta(key, V(), false);
       return;
     }
     throw std:: out_of_range("ArrayMap<K,V>::operator[](const K& key");
@@ -161,36 +535,273 @@ int BinSearchMap<K,V>::size() const{
 
   // Returns true if the key is in the collection, and false
   // otherwise.
-  template<typename K, typename V>
-  bool BinSearchMap<K,V>::contains(const K& key) const{
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  bool BinSearchMap<K,V,Seq,Search>::contains(const K& key) const{
+    const Delta* d = find_delta(key);
+    if(d != nullptr){
+      return d->live;
+    }
     int i = 0;
     return bin_search(key,i);
   }
 
   // Returns the keys k in the collection such that k1 <= k <= k2
-  template<typename K, typename V>
-  ArraySeq<K> BinSearchMap<K,V>::find_keys(const K& k1, const K& k2) const{
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  ArraySeq<K> BinSearchMap<K,V,Seq,Search>::find_keys(const K& k1, const K& k2) const{
     ArraySeq<K> keyList;
-    int start = 0, end = 0, i = 0;
-    if(seq.empty()){return keyList;}
-    bin_search(k1,start);
-    bin_search(k2,end);
-    for(start; start <= end; start++){
-      keyList.insert(seq[start].first, i);
-      ++i;
+    if(delta_count == 0){
+      int start = lower_bound(k1);
+      int end = upper_bound(k2);
+      keyList.reserve(std::max(0, end - start));
     }
+    walk_merged(&k1, &k2, [&keyList](const K& key, const V&){
+      keyList.insert(key, keyList.size());
+    });
     return keyList;
     
   }
 
   // Returns the keys in the collection in ascending sorted order.
-  template<typename K, typename V>
-  ArraySeq<K> BinSearchMap<K,V>::sorted_keys() const{
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  ArraySeq<K> BinSearchMap<K,V,Seq,Search>::sorted_keys() const{
     ArraySeq<K> keyList;
-    for(int i = 0; i < seq.size(); i++){
-      keyList.insert(seq[i].first, i);
-    }
+    keyList.reserve(count);
+    walk_merged(nullptr, nullptr, [&keyList](const K& key, const V&){
+      keyList.insert(key, keyList.size());
+    });
     return keyList;
   }
 
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::insert_batch(const ArraySeq<K>& batch_keys,
+                                                  const ArraySeq<V>& batch_values){
+    this->check_batch(batch_keys, batch_values);
+    if(batch_keys.empty()){
+      return;
+    }
+    flush();
+    FlatSeq<int> order = this->batch_order(batch_keys);
+    Seq<K> new_keys;
+    Seq<V> new_vals;
+    int i = 0, j = 0;
+    while(i < keys.size() || j < order.size()){
+      if(j == order.size() ||
+         (i < keys.size() && keys.unchecked_at(i) < batch_keys.unchecked_at(order.unchecked_at(j)))){
+        new_keys.insert(std::move(keys.unchecked_at(i)), new_keys.size());
+        new_vals.insert(std::move(vals.unchecked_at(i)), new_vals.size());
+        ++i;
+      }
+      else {
+        int b = order.unchecked_at(j++);
+        new_keys.insert(batch_keys.unchecked_at(b), new_keys.size());
+        new_vals.insert(batch_values.unchecked_at(b), new_vals.size());
+      }
+    }
+    keys = std::move(new_keys);
+    vals = std::move(new_vals);
+    search.rebuild(keys);
+    count = keys.size();
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::erase_batch(const ArraySeq<K>& batch_keys){
+    if(batch_keys.empty()){
+      return;
+    }
+    flush();
+    FlatSeq<int> order = this->batch_order(batch_keys);
+    // check every key first, so that the map is untouched if one is
+    // missing
+    int i = 0;
+    for(int b : order){
+      const K& key = batch_keys.unchecked_at(b);
+      i = branchless_lower_bound(keys, i, keys.size() - i, key);
+      if(i == keys.size() || !(keys.unchecked_at(i) == key)){
+        throw std::out_of_range("BinSearchMap<K,V>::erase_batch(batch_keys)");
+      }
+    }
+    Seq<K> new_keys;
+    Seq<V> new_vals;
+    int j = 0;
+    for(i = 0; i < keys.size(); i++){
+      if(j < order.size() && keys.unchecked_at(i) == batch_keys.unchecked_at(order.unchecked_at(j))){
+        ++j;
+      }
+      else {
+        new_keys.insert(std::move(keys.unchecked_at(i)), new_keys.size());
+        new_vals.insert(std::move(vals.unchecked_at(i)), new_vals.size());
+      }
+    }
+    keys = std::move(new_keys);
+    vals = std::move(new_vals);
+    search.rebuild(keys);
+    count = keys.size();
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  ArraySeq<bool> BinSearchMap<K,V,Seq,Search>::contains_batch(const ArraySeq<K>& batch_keys) const{
+    FlatSeq<int> order = this->batch_order(batch_keys);
+    ArraySeq<bool> found;
+    found.reserve(batch_keys.size());
+    for(int j = 0; j < batch_keys.size(); j++){
+      found.insert(false, j);
+    }
+    int i = 0;
+    for(int b : order){
+      const K& key = batch_keys.unchecked_at(b);
+      i = branchless_lower_bound(keys, i, keys.size() - i, key);
+      // a buffered insert or erase overrides the arrays
+      const Delta* d = find_delta(key);
+      found.unchecked_at(b) = d != nullptr ? d->live : i < keys.size() && keys.unchecked_at(i) == key;
+    }
+    return found;
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  SeqView<K> BinSearchMap<K,V,Seq,Search>::find_range(const K& k1, const K& k2){
+    flush();
+    int start = lower_bound(k1);
+    int end = upper_bound(k2);
+    return SeqView<K>(keys.data() + start, std::max(0, end - start));
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  SeqView<V> BinSearchMap<K,V,Seq,Search>::value_range(const K& k1, const K& k2){
+    flush();
+    int start = lower_bound(k1);
+    int end = upper_bound(k2);
+    return SeqView<V>(vals.data() + start, std::max(0, end - start));
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  SeqView<K> BinSearchMap<K,V,Seq,Search>::sorted_view(){
+    flush();
+    return SeqView<K>(keys.data(), keys.size());
+  }
+
+  // Merges all buffered inserts and erases into the sorted arrays in
+  // one linear pass. Buffered entries replace (live) or remove
+  // (tombstone) array entries with the same key.
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::flush(){
+    if(delta_count == 0){
+      return;
+    }
+    FlatSeq<Delta> delta;
+    int unused = 0;
+    for(int r = 0; r < max_runs; r++){
+      if(!runs[r].empty()){
+        delta = merge_runs(runs[r], delta, unused);
+        runs[r] = FlatSeq<Delta>();
+      }
+    }
+
+    Seq<K> new_keys;
+    Seq<V> new_vals;
+    int i = 0, j = 0;
+    while(i < keys.size() || j < delta.size()){
+      OP_COUNT(comparisons, i < keys.size() && j < delta.size() ? 1 : 0);
+      if(j == delta.size() ||
+         (i < keys.size() && keys.unchecked_at(i) < delta.unchecked_at(j).key)){
+        OP_COUNT(moves, 1);
+        new_keys.insert(std::move(keys.unchecked_at(i)), new_keys.size());
+        new_vals.insert(std::move(vals.unchecked_at(i)), new_vals.size());
+        ++i;
+      }
+      else {
+        Delta& d = delta.unchecked_at(j++);
+        OP_COUNT(comparisons, i < keys.size() ? 1 : 0);
+        if(i < keys.size() && !(d.key < keys.unchecked_at(i))){
+          ++i;
+        }
+        OP_COUNT(moves, d.live ? 1 : 0);
+        if(d.live){
+          new_keys.insert(std::move(d.key), new_keys.size());
+          new_vals.insert(std::move(d.value), new_vals.size());
+        }
+      }
+    }
+    keys = std::move(new_keys);
+    vals = std::move(new_vals);
+    search.rebuild(keys);
+    delta_count = 0;
+    count = keys.size();
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  void BinSearchMap<K,V,Seq,Search>::assign_sorted(SeqView<K> new_keys, SeqView<V> new_values){
+    if(new_keys.size() != new_values.size()){
+      throw std::out_of_range("BinSearchMap<K,V>::assign_sorted(new_keys, new_values)");
+    }
+    for(int r = 0; r < max_runs; r++){
+      runs[r] = FlatSeq<Delta>();
+    }
+    delta_count = 0;
+    keys = Seq<K>();
+    vals = Seq<V>();
+    if constexpr(std::is_same<Seq<K>, FlatSeq<K>>::value){
+      keys.append(new_keys.data(), new_keys.size());
+      vals.append(new_values.data(), new_values.size());
+    }
+    else {
+      for(int i = 0; i < new_keys.size(); i++){
+        keys.insert(new_keys.data()[i], i);
+        vals.insert(new_values.data()[i], i);
+      }
+    }
+    search.rebuild(keys);
+    count = keys.size();
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  const Search& BinSearchMap<K,V,Seq,Search>::search_policy(){
+    flush();
+    return search;
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  template<typename F>
+  void BinSearchMap<K,V,Seq,Search>::for_each(F visit){
+    flush();
+    walk(0, keys.size(), visit);
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  template<typename F>
+  void BinSearchMap<K,V,Seq,Search>::for_each(F visit) const{
+    walk_merged(nullptr, nullptr, [&visit](const K& key, const V& value){visit(key, value);});
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  template<typename F>
+  void BinSearchMap<K,V,Seq,Search>::for_each_in_range(const K& k1, const K& k2, F visit){
+    flush();
+    walk(lower_bound(k1), upper_bound(k2), visit);
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  template<typename F>
+  void BinSearchMap<K,V,Seq,Search>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+    walk_merged(&k1, &k2, [&visit](const K& key, const V& value){visit(key, value);});
+  }
+
+  template<typename K, typename V, template<typename> class Seq, typename Search>
+  MemoryUsage BinSearchMap<K,V,Seq,Search>::memory_usage() const{
+    MemoryUsage usage = keys.memory_usage();
+    usage += vals.memory_usage();
+    for(int r = 0; r < max_runs; r++){
+      MemoryUsage run = runs[r].memory_usage();
+      long flags = (long) runs[r].size() * (sizeof(Delta) - sizeof(K) - sizeof(V));
+      run.payload -= flags;
+      run.overhead += flags;
+      usage += run;
+    }
+    usage.metadata += sizeof(*this) - sizeof(keys) - sizeof(vals) - sizeof(runs);
+    if constexpr(has_memory_usage<Search>){
+      usage += search.memory_usage().as_metadata();
+      usage.metadata -= sizeof(search);
+    }
+    return usage;
+  }
+
 #endif
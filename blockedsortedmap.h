@@ -0,0 +1,535 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: blockedsortedmap.h
+// DATE: Fall 2021
+// DESC: Ordered map stored as a list of sorted blocks (square root
+//       decomposition, like Python's SortedList). Each block holds
+//       up to max_block pairs in two parallel sorted arrays, and a
+//       fence array holds each block's first key. A lookup binary
+//       searches the fences and then one block, for O(log n) with
+//       contiguous memory. An insert or erase shifts the pairs of
+//       one block (O(B)) and, when a block splits or merges, the
+//       pointers and fences after it (O(n/B), a single memmove).
+//---------------------------------------------------------------------------
+
+#ifndef BLOCKEDSORTEDMAP_H
+#define BLOCKEDSORTEDMAP_H
+
+#include <stdexcept>
+#include <utility>
+#include "map.h"
+#include "arrayseq.h"
+#include "searchpolicy.h"
+#include "memoryusage.h"
+
+
+template<typename K, typename V>
+class BlockedSortedMap final : public Map<K,V>
+{
+public:
+
+  // Default constructor
+  BlockedSortedMap();
+
+  // Copy constructor
+  BlockedSortedMap(const BlockedSortedMap& rhs);
+
+  // Move constructor
+  BlockedSortedMap(BlockedSortedMap&& rhs);
+
+  // Copy assignment operator
+  BlockedSortedMap& operator=(const BlockedSortedMap& rhs);
+
+  // Move assignment operator
+  BlockedSortedMap& operator=(BlockedSortedMap&& rhs);
+
+  // Destructor
+  ~BlockedSortedMap();
+
+  // Returns the number of key-value pairs in the map
+  int size() const;
+
+  // Tests if the map is empty
+  bool empty() const;
+
+  // Allows values associated with a key to be updated. Throws
+  // out_of_range if the given key is not in the collection.
+  V& operator[](const K& key);
+
+  // Returns the value for a given key. Throws out_of_range if the
+  // given key is not in the collection.
+  const V& operator[](const K& key) const;
+
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws.
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
+  // Extends the collection by adding the given key-value pair. If
+  // the key is already present the collection is left unchanged.
+  void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
+
+  // Shrinks the collection by removing the key-value pair with the
+  // given key. Does not modify the collection if the collection does
+  // not contain the key. Throws out_of_range if the given key is not
+  // in the collection.
+  void erase(const K& key);
+
+  // Returns true if the key is in the collection, and false
+  // otherwise.
+  bool contains(const K& key) const;
+
+  // Returns the keys k in the collection such that k1 <= k <= k2
+  ArraySeq<K> find_keys(const K& k1, const K& k2) const;
+
+  // Returns the keys in the collection in ascending sorted order.
+  ArraySeq<K> sorted_keys() const;
+
+  // Returns the number of blocks
+  int block_count() const;
+
+  // Returns the bytes the map uses (see memoryusage.h). Unused block
+  // capacity is slack, and the block list and fences are metadata.
+  MemoryUsage memory_usage() const;
+
+  // Calls visit(key, value) on every pair in ascending key order,
+  // without allocating. visit may modify the values, but must not
+  // otherwise modify the map.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2
+  // (O(log n + k))
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+private:
+
+  // a full block splits into two halves
+  static constexpr int max_block = 512;
+
+  // a block this small merges with a neighbour (if they fit in one
+  // block)
+  static constexpr int min_block = max_block / 4;
+
+  // one run of pairs, sorted by key (vals[i] is the value for keys[i])
+  struct Block {
+    FlatSeq<K> keys;
+    FlatSeq<V> vals;
+  };
+
+  // blocks in key order: every key in blocks[b] is less than every
+  // key in blocks[b+1], and fences[b] is the first key of blocks[b]
+  FlatSeq<Block*> blocks;
+  FlatSeq<K> fences;
+
+  // number of key-value pairs in the map
+  int count = 0;
+
+  // helper to find the block that holds (or would hold) the key
+  int find_block(const K& key) const{
+    int b = branchless_lower_bound(fences, 0, fences.size(), key);
+    if(b == fences.size() || key < fences.unchecked_at(b)){
+      --b;
+    }
+    return b < 0 ? 0 : b;
+  }
+
+  // helper to find the key: returns true and sets b and i (its block
+  // and index within the block) if the key is in the map
+  bool locate(const K& key, int& b, int& i) const{
+    if(count == 0){
+      return false;
+    }
+    b = find_block(key);
+    const FlatSeq<K>& keys = blocks.unchecked_at(b)->keys;
+    i = branchless_lower_bound(keys, 0, keys.size(), key);
+    return i < keys.size() && keys.unchecked_at(i) == key;
+  }
+
+  // helper for for_each and for_each_in_range: calls visit(key,
+  // value) on the pairs from index i of block b onwards, stopping at
+  // the first key greater than *last (if last is not nullptr)
+  template<typename F>
+  void walk(int b, int i, const K* last, F&& visit) const{
+    for(; b < blocks.size(); b++, i = 0){
+      Block* block = blocks.unchecked_at(b);
+      for(; i < block->keys.size(); i++){
+        const K& key = block->keys.unchecked_at(i);
+        if(last != nullptr && *last < key){
+          return;
+        }
+        visit(key, block->vals.unchecked_at(i));
+      }
+    }
+  }
+
+  // helper for for_each_in_range: calls visit on the pairs with keys
+  // k1 <= k <= k2
+  template<typename F>
+  void walk_range(const K& k1, const K& k2, F&& visit) const{
+    if(count == 0){
+      return;
+    }
+    int b = find_block(k1);
+    const FlatSeq<K>& keys = blocks.unchecked_at(b)->keys;
+    walk(b, branchless_lower_bound(keys, 0, keys.size(), k1), &k2, visit);
+  }
+
+  // helper for the inserts: returns the key's value if the key is
+  // present, and otherwise inserts the pair (key, make_value()) into
+  // the block it belongs in, splitting the block once it is full.
+  // The key is only moved from (if it is an rvalue) when the pair is
+  // inserted.
+  template<typename KK, typename F>
+  std::pair<V*,bool> find_or_insert(KK&& key, F make_value){
+    if(count == 0){
+      make_empty();
+      Block* block = new Block;
+      block->keys.reserve(max_block);
+      block->vals.reserve(max_block);
+      blocks.insert(block, 0);
+      fences.insert(key, 0);
+    }
+    int b = find_block(key);
+    Block* block = blocks.unchecked_at(b);
+    int i = branchless_lower_bound(block->keys, 0, block->keys.size(), key);
+    if(i < block->keys.size() && block->keys.unchecked_at(i) == key){
+      return {&block->vals.unchecked_at(i), false};
+    }
+    block->keys.insert(std::forward<KK>(key), i);
+    block->vals.insert(make_value(), i);
+    if(i == 0){
+      fences.unchecked_at(b) = block->keys.unchecked_at(0);
+    }
+    ++count;
+    if(block->keys.size() >= max_block){
+      split(b);
+      // the pair may have moved to the new right half
+      int half = block->keys.size();
+      if(i >= half){
+        ++b;
+        i -= half;
+      }
+    }
+    return {&blocks.unchecked_at(b)->vals.unchecked_at(i), true};
+  }
+
+  // helper to split block b into two halves
+  void split(int b){
+    Block* left = blocks.unchecked_at(b);
+    Block* right = new Block;
+    int half = left->keys.size() / 2;
+    int n = left->keys.size();
+    right->keys.reserve(max_block);
+    right->vals.reserve(max_block);
+    for(int i = half; i < n; i++){
+      right->keys.insert(std::move(left->keys.unchecked_at(i)), i - half);
+      right->vals.insert(std::move(left->vals.unchecked_at(i)), i - half);
+    }
+    while(left->keys.size() > half){
+      left->keys.erase(left->keys.size() - 1);
+      left->vals.erase(left->vals.size() - 1);
+    }
+    blocks.insert(right, b + 1);
+    fences.insert(right->keys.unchecked_at(0), b + 1);
+  }
+
+  // helper to append block b+1 to block b and remove block b+1
+  void merge(int b){
+    Block* left = blocks.unchecked_at(b);
+    Block* right = blocks.unchecked_at(b + 1);
+    for(int i = 0; i < right->keys.size(); i++){
+      left->keys.insert(std::move(right->keys.unchecked_at(i)), left->keys.size());
+      left->vals.insert(std::move(right->vals.unchecked_at(i)), left->vals.size());
+    }
+    delete right;
+    blocks.erase(b + 1);
+    fences.erase(b + 1);
+  }
+
+  // helper to delete every block (called by destructor and
+  // assignment)
+  void make_empty(){
+    for(Block* block : blocks){
+      delete block;
+    }
+    blocks = FlatSeq<Block*>();
+    fences = FlatSeq<K>();
+    count = 0;
+  }
+};
+
+
+template<typename K, typename V>
+BlockedSortedMap<K,V>::BlockedSortedMap()
+{
+  return;
+}
+
+  template<typename K, typename V>
+  BlockedSortedMap<K,V>::BlockedSortedMap(const BlockedSortedMap& rhs){
+    *this = rhs;
+  }
+
+  template<typename K, typename V>
+  BlockedSortedMap<K,V>::BlockedSortedMap(BlockedSortedMap&& rhs){
+    *this = std::move(rhs);
+  }
+
+  template<typename K, typename V>
+  BlockedSortedMap<K,V>& BlockedSortedMap<K,V>::operator=(const BlockedSortedMap& rhs){
+    if(this != &rhs){
+      make_empty();
+      blocks.reserve(rhs.blocks.size());
+      for(Block* block : rhs.blocks){
+        blocks.insert(new Block(*block), blocks.size());
+      }
+      fences = rhs.fences;
+      count = rhs.count;
+    }
+    return *this;
+  }
+
+  template<typename K, typename V>
+  BlockedSortedMap<K,V>& BlockedSortedMap<K,V>::operator=(BlockedSortedMap&& rhs){
+    if(this != &rhs){
+      make_empty();
+      blocks = std::move(rhs.blocks);
+      fences = std::move(rhs.fences);
+      count = rhs.count;
+      rhs.count = 0;
+    }
+    return *this;
+  }
+
+  template<typename K, typename V>
+  BlockedSortedMap<K,V>::~BlockedSortedMap(){
+    make_empty();
+  }
+
+  template<typename K, typename V>
+  int BlockedSortedMap<K,V>::size() const{
+    return count;
+  }
+
+  template<typename K, typename V>
+  bool BlockedSortedMap<K,V>::empty() const{
+    return count == 0;
+  }
+
+  template<typename K, typename V>
+  V& BlockedSortedMap<K,V>::operator[](const K& key){
+    int b, i;
+    if(!locate(key, b, i)){
+      throw std::out_of_range("BlockedSortedMap<K,V>::operator[](const K& key)");
+    }
+    return blocks.unchecked_at(b)->vals.unchecked_at(i);
+  }
+
+  template<typename K, typename V>
+  const V& BlockedSortedMap<K,V>::operator[](const K& key) const{
+    int b, i;
+    if(!locate(key, b, i)){
+      throw std::out_of_range("BlockedSortedMap<K,V>::operator[](const K& key)");
+    }
+    return blocks.unchecked_at(b)->vals.unchecked_at(i);
+  }
+
+  template<typename K, typename V>
+  V* BlockedSortedMap<K,V>::find(const K& key) noexcept{
+    int b, i;
+    return locate(key, b, i) ? &blocks.unchecked_at(b)->vals.unchecked_at(i) : nullptr;
+  }
+
+  template<typename K, typename V>
+  const V* BlockedSortedMap<K,V>::find(const K& key) const noexcept{
+    int b, i;
+    return locate(key, b, i) ? &blocks.unchecked_at(b)->vals.unchecked_at(i) : nullptr;
+  }
+
+  // Inserts into the block the key belongs in, splitting the block
+  // once it is full
+  template<typename K, typename V>
+  void BlockedSortedMap<K,V>::insert(const K& key, const V& value){
+    find_or_insert(key, [&]() -> const V& {return value;});
+  }
+
+  template<typename K, typename V>
+  void BlockedSortedMap<K,V>::insert(K&& key, V&& value){
+    find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> BlockedSortedMap<K,V>::try_insert(const K& key, const V& value){
+    return find_or_insert(key, [&]() -> const V& {return value;});
+  }
+
+  template<typename K, typename V>
+  bool BlockedSortedMap<K,V>::insert_or_assign(const K& key, const V& value){
+    std::pair<V*,bool> result = find_or_insert(key, [&]() -> const V& {return value;});
+    if(!result.second){
+      *result.first = value;
+    }
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> BlockedSortedMap<K,V>::try_insert(K&& key, V&& value){
+    return find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+  }
+
+  template<typename K, typename V>
+  bool BlockedSortedMap<K,V>::insert_or_assign(K&& key, V&& value){
+    std::pair<V*,bool> result = find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+    if(!result.second){
+      *result.first = std::move(value);
+    }
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> BlockedSortedMap<K,V>::emplace(KK&& key, Args&&... args){
+    return find_or_insert(std::forward<KK>(key), [&]() {return V(std::forward<Args>(args)...);});
+  }
+
+  // Erases from the key's block, merging the block with a neighbour
+  // once it gets small
+  template<typename K, typename V>
+  void BlockedSortedMap<K,V>::erase(const K& key){
+    int b, i;
+    if(!locate(key, b, i)){
+      throw std::out_of_range("BlockedSortedMap<K,V>::erase(const K& key)");
+    }
+    Block* block = blocks.unchecked_at(b);
+    block->keys.erase(i);
+    block->vals.erase(i);
+    --count;
+    if(block->keys.empty()){
+      delete block;
+      blocks.erase(b);
+      fences.erase(b);
+      return;
+    }
+    if(i == 0){
+      fences.unchecked_at(b) = block->keys.unchecked_at(0);
+    }
+    if(block->keys.size() < min_block){
+      if(b + 1 < blocks.size() &&
+         block->keys.size() + blocks.unchecked_at(b + 1)->keys.size() < max_block){
+        merge(b);
+      }
+      else if(b > 0 &&
+              block->keys.size() + blocks.unchecked_at(b - 1)->keys.size() < max_block){
+        merge(b - 1);
+      }
+    }
+  }
+
+  template<typename K, typename V>
+  bool BlockedSortedMap<K,V>::contains(const K& key) const{
+    int b, i;
+    return locate(key, b, i);
+  }
+
+  // Returns the keys k in the collection such that k1 <= k <= k2
+  template<typename K, typename V>
+  ArraySeq<K> BlockedSortedMap<K,V>::find_keys(const K& k1, const K& k2) const{
+    ArraySeq<K> keyList;
+    if(count == 0){
+      return keyList;
+    }
+    int b = find_block(k1);
+    const FlatSeq<K>& first = blocks.unchecked_at(b)->keys;
+    int i = branchless_lower_bound(first, 0, first.size(), k1);
+    for(; b < blocks.size(); b++, i = 0){
+      const FlatSeq<K>& keys = blocks.unchecked_at(b)->keys;
+      for(; i < keys.size(); i++){
+        if(k2 < keys.unchecked_at(i)){
+          return keyList;
+        }
+        keyList.insert(keys.unchecked_at(i), keyList.size());
+      }
+    }
+    return keyList;
+  }
+
+  // Returns the keys in the collection in ascending sorted order.
+  template<typename K, typename V>
+  ArraySeq<K> BlockedSortedMap<K,V>::sorted_keys() const{
+    ArraySeq<K> keyList;
+    keyList.reserve(count);
+    for(Block* block : blocks){
+      for(const K& key : block->keys){
+        keyList.insert(key, keyList.size());
+      }
+    }
+    return keyList;
+  }
+
+  template<typename K, typename V>
+  int BlockedSortedMap<K,V>::block_count() const{
+    return blocks.size();
+  }
+
+  template<typename K, typename V>
+  MemoryUsage BlockedSortedMap<K,V>::memory_usage() const{
+    MemoryUsage usage;
+    for(int b = 0; b < blocks.size(); b++){
+      const Block* block = blocks.unchecked_at(b);
+      usage += block->keys.memory_usage();
+      usage += block->vals.memory_usage();
+      usage.metadata += sizeof(Block) - sizeof(block->keys) - sizeof(block->vals);
+    }
+    usage += blocks.memory_usage().as_metadata();
+    usage += fences.memory_usage().as_metadata();
+    usage.metadata += sizeof(*this) - sizeof(blocks) - sizeof(fences);
+    return usage;
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void BlockedSortedMap<K,V>::for_each(F visit){
+    walk(0, 0, nullptr, visit);
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void BlockedSortedMap<K,V>::for_each(F visit) const{
+    walk(0, 0, nullptr, [&visit](const K& key, const V& value){visit(key, value);});
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void BlockedSortedMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit){
+    walk_range(k1, k2, visit);
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void BlockedSortedMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+    walk_range(k1, k2, [&visit](const K& key, const V& value){visit(key, value);});
+  }
+
+#endif
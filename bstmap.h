@@ -1,34 +1,44 @@
 //---------------------------------------------------------------------------
 // NAME: Dominic MacIsaac
 // DATE: Fall 2021
-// DESC: Implementation of Binary Search Tree
+// DESC: Implementation of Binary Search Tree (the nodes are allocated
+//       from a memory resource)
 //---------------------------------------------------------------------------
 
 #ifndef BSTMAP_H
 #define BSTMAP_H
 
+#include <algorithm>
+#include <memory_resource>
 #include "map.h"
 #include "arrayseq.h"
+#include "memoryusage.h"
+#include "opcounters.h"
 
 
 template<typename K, typename V>
-class BSTMap : public Map<K,V>
+class BSTMap final : public Map<K,V>
 {
 public:
 
   // default constructor
   BSTMap();
 
-  // copy constructor
+  // Creates an empty map whose nodes (and the key lists find_keys and
+  // sorted_keys return) are allocated from the given memory resource
+  explicit BSTMap(std::pmr::memory_resource* resource);
+
+  // copy constructor (the copy allocates from the default resource)
   BSTMap(const BSTMap& rhs);
 
-  // move constructor
+  // move constructor (takes over rhs's memory resource)
   BSTMap(BSTMap&& rhs);
 
   // copy assignment
   BSTMap& operator=(const BSTMap& rhs);
 
-  // move assignment
+  // move assignment (copies the pairs instead if the two maps'
+  // memory resources differ)
   BSTMap& operator=(BSTMap&& rhs);  
 
   // destructor
@@ -48,10 +58,31 @@ public:
   // given key is not in the collection. 
   const V& operator[](const K& key) const;
 
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws.
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
   // Extends the collection by adding the given key-value
   // pair. Assumes the key being added is not present in the
   // collection. Insert does not check if the key is present.
   void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
 
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
@@ -70,6 +101,33 @@ public:
 
   // Returns the height of the binary search tree
   int height() const;
+
+  // Calls visit(key, value) on every pair in ascending key order,
+  // without allocating. visit may modify the values, but must not
+  // otherwise modify the map.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2,
+  // skipping the subtrees outside the range
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+  // Sorts the batch and inserts it in one descent: each node is
+  // visited once for all the batch keys below it, and the keys that
+  // reach an empty subtree are built into a balanced subtree
+  void insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values);
+
+  // Returns the memory resource the map allocates from
+  std::pmr::memory_resource* memory_resource() const;
+
+  // Returns the bytes the map uses (see memoryusage.h). Each node's
+  // child pointers and padding are overhead.
+  MemoryUsage memory_usage() const;
   
 private:
 
@@ -87,6 +145,69 @@ private:
   // array of linked lists
   Node* root = nullptr;
 
+  // where the nodes are allocated
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+  // helpers to allocate and free a node from the resource
+  template<typename... Args>
+  Node* make_node(Args&&... args) const{
+    void* mem = resource->allocate(sizeof(Node), alignof(Node));
+    try {
+      return new (mem) Node{std::forward<Args>(args)...};
+    }
+    catch(...) {
+      resource->deallocate(mem, sizeof(Node), alignof(Node));
+      throw;
+    }
+  }
+
+  void free_node(Node* node){
+    node->~Node();
+    resource->deallocate(node, sizeof(Node), alignof(Node));
+  }
+
+  // helper to find the node holding the key (nullptr if none)
+  Node* find_node(const K& key) const{
+    Node* temp = root;
+    while(temp != nullptr && !(key == temp->key)){
+      OP_COUNT(node_hops, 1);
+      temp = key < temp->key ? temp->left : temp->right;
+    }
+    return temp;
+  }
+
+  // helper for both inserts: adds the pair as a leaf (equal keys go
+  // left), constructing the node's key and value in place
+  template<typename KK, typename VV>
+  void insert_pair(KK&& key, VV&& value){
+    Node** link = &root;
+    while(*link != nullptr){
+      OP_COUNT(node_hops, 1);
+      link = key > (*link)->key ? &(*link)->right : &(*link)->left;
+    }
+    *link = make_node(std::forward<KK>(key), std::forward<VV>(value), nullptr, nullptr);
+    count++;
+  }
+
+  // helper for the single-lookup inserts: returns the key's value
+  // if the key is in the tree, and otherwise adds the pair (key,
+  // make_value()) as a leaf where the search ended. The key is only
+  // moved from (if it is an rvalue) when the pair is added.
+  template<typename KK, typename F>
+  std::pair<V*,bool> find_or_insert(KK&& key, F make_value){
+    Node** link = &root;
+    while(*link != nullptr){
+      if(key == (*link)->key){
+        return {&(*link)->value, false};
+      }
+      OP_COUNT(node_hops, 1);
+      link = key < (*link)->key ? &(*link)->left : &(*link)->right;
+    }
+    *link = make_node(std::forward<KK>(key), make_value(), nullptr, nullptr);
+    count++;
+    return {&(*link)->value, true};
+  }
+
   // clean up the tree and reset count to zero given subtree root
   void make_empty(Node* st_root);
 
@@ -105,6 +226,21 @@ private:
 
   // height helper
   int height(const Node* st_root) const;
+
+  // for_each helper (NodeT is Node or const Node, and the recursion
+  // keeps it, so the values are const in the const for_each)
+  template<typename NodeT, typename F>
+  static void walk(NodeT* st_root, F& visit);
+
+  // for_each_in_range helper
+  template<typename NodeT, typename F>
+  static void walk_range(NodeT* st_root, const K& k1, const K& k2, F& visit);
+
+  // insert_batch helper: inserts the batch pairs order[lo..hi) (in
+  // ascending key order) into the subtree at link
+  void insert_sorted(Node*& link, const ArraySeq<K>& batch_keys,
+                     const ArraySeq<V>& batch_values,
+                     const FlatSeq<int>& order, int lo, int hi);
   
 };
 
@@ -113,6 +249,11 @@ BSTMap<K,V>::BSTMap(){
   return;
 }
 
+template<typename K, typename V>
+BSTMap<K,V>::BSTMap(std::pmr::memory_resource* resource)
+  : resource(resource){
+}
+
   // copy constructor
 template<typename K, typename V>
 BSTMap<K,V>::BSTMap(const BSTMap& rhs){
@@ -122,7 +263,8 @@ BSTMap<K,V>::BSTMap(const BSTMap& rhs){
 
   // move constructor
 template<typename K, typename V>
-BSTMap<K,V>::BSTMap(BSTMap&& rhs){
+BSTMap<K,V>::BSTMap(BSTMap&& rhs)
+  : resource(rhs.resource){
   *this = std::move(rhs);
   return;
 }
@@ -142,6 +284,10 @@ BSTMap<K,V>& BSTMap<K,V>::operator=(const BSTMap& rhs){
 template<typename K, typename V>
 BSTMap<K,V>& BSTMap<K,V>::operator=(BSTMap&& rhs){
   if(this != &rhs){
+    if(!resource->is_equal(*rhs.resource)){
+      // rhs's nodes can't be freed through this resource
+      return *this = static_cast<const BSTMap&>(rhs);
+    }
     make_empty(root);
     root = rhs.root;
     count = rhs.count;
@@ -178,49 +324,34 @@ bool BSTMap<K,V>::empty() const{
   // out_of_range if the given key is not in the collection.
 template<typename K, typename V>
 V& BSTMap<K,V>::operator[](const K& key){
-  if(empty()){
+  Node* node = find_node(key);
+  if(node == nullptr){
     throw std:: out_of_range("BSTMap<K,V>::operator[](const K& key");
   }
-  Node* temp = root;
-  while(temp!= nullptr){
-    if(key == temp->key){
-      return temp->value;
-    }
-
-    if(key > temp->key){
-      temp = temp->right;
-    }
-
-    if(key < temp->key){
-      temp = temp->left;
-    }
-  }
-  throw std:: out_of_range("BSTMap<K,V>::operator[](const K& key");
-
+  return node->value;
 }
 
   // Returns the value for a given key. Throws out_of_range if the
   // given key is not in the collection. 
 template<typename K, typename V>
 const V& BSTMap<K,V>::operator[](const K& key) const{
-   if(empty()){
+  const Node* node = find_node(key);
+  if(node == nullptr){
     throw std:: out_of_range("BSTMap<K,V>::operator[](const K& key");
   }
-  Node* temp = root;
-  while(temp!= nullptr){
-    if(key == temp->key){
-      return temp->value;
-    }
+  return node->value;
+}
 
-    if(key > temp->key){
-      temp = temp->right;
-    }
+template<typename K, typename V>
+V* BSTMap<K,V>::find(const K& key) noexcept{
+  Node* node = find_node(key);
+  return node != nullptr ? &node->value : nullptr;
+}
 
-    if(key < temp->key){
-      temp = temp->left;
-    }
-  }
-  throw std:: out_of_range("BSTMap<K,V>::operator[](const K& key");
+template<typename K, typename V>
+const V* BSTMap<K,V>::find(const K& key) const noexcept{
+  const Node* node = find_node(key);
+  return node != nullptr ? &node->value : nullptr;
 }
 
   // Extends the collection by adding the given key-value
@@ -228,40 +359,46 @@ const V& BSTMap<K,V>::operator[](const K& key) const{
   // collection. Insert does not check if the key is present.
 template<typename K, typename V>
 void BSTMap<K,V>::insert(const K& key, const V& value){
-  Node* temp = root;
+  insert_pair(key, value);
+}
 
-  Node* newNode = new Node;
-  newNode->left = nullptr;
-  newNode->right = nullptr;
-  newNode->key = key;
-  newNode->value = value;
+template<typename K, typename V>
+void BSTMap<K,V>::insert(K&& key, V&& value){
+  insert_pair(std::move(key), std::move(value));
+}
 
-  if(empty()){
-    root = newNode;
-    count++;
-    return;
+template<typename K, typename V>
+std::pair<V*,bool> BSTMap<K,V>::try_insert(const K& key, const V& value){
+  return find_or_insert(key, [&]() -> const V& {return value;});
+}
+
+template<typename K, typename V>
+bool BSTMap<K,V>::insert_or_assign(const K& key, const V& value){
+  std::pair<V*,bool> result = find_or_insert(key, [&]() -> const V& {return value;});
+  if(!result.second){
+    *result.first = value;
   }
+  return result.second;
+}
 
-  count++;
-  while(temp != nullptr){
-    if(key > temp->key){
-      if(temp->right == nullptr){
-        temp->right = newNode;
-        return;
-      }
-      temp = temp->right;
-    }
-    if(key <= temp->key){
-      if(temp->left == nullptr){
-        temp->left = newNode;
-        return;
-      }
+template<typename K, typename V>
+std::pair<V*,bool> BSTMap<K,V>::try_insert(K&& key, V&& value){
+  return find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+}
 
-      temp = temp->left;
-    }
+template<typename K, typename V>
+bool BSTMap<K,V>::insert_or_assign(K&& key, V&& value){
+  std::pair<V*,bool> result = find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+  if(!result.second){
+    *result.first = std::move(value);
   }
+  return result.second;
+}
 
-  return;
+template<typename K, typename V>
+template<typename KK, typename... Args>
+std::pair<V*,bool> BSTMap<K,V>::emplace(KK&& key, Args&&... args){
+  return find_or_insert(std::forward<KK>(key), [&]() {return V(std::forward<Args>(args)...);});
 }
 
   // Shrinks the collection by removing the key-value pair with the
@@ -281,34 +418,13 @@ void BSTMap<K,V>::erase(const K& key){
   // Returns true if the key is in the collection, and false otherwise.
 template<typename K, typename V>
 bool BSTMap<K,V>::contains(const K& key) const{
-  if(empty()){return false;}
-  Node* temp = root;
-  while(temp != nullptr){
-    if(key == temp->key){
-      return true;
-    }
-
-    if(key > temp->key){
-      if(temp->right == nullptr){
-        return false;
-      }
-      temp = temp->right;
-    }
-
-    if(key < temp->key){
-      if(temp->left == nullptr){
-        return false;
-      }
-      temp = temp->left;
-    }
-  }
-  return false;
+  return find_node(key) != nullptr;
 }
 
   // Returns the keys k in the collection such that k1 <= k <= k2
 template<typename K, typename V>
 ArraySeq<K> BSTMap<K,V>::find_keys(const K& k1, const K& k2) const{
-  ArraySeq<K> keyList;
+  ArraySeq<K> keyList(resource);
   find_keys(k1,k2,root, keyList);
   return keyList;
 }
@@ -316,7 +432,7 @@ ArraySeq<K> BSTMap<K,V>::find_keys(const K& k1, const K& k2) const{
   // Returns the keys in the collection in ascending sorted order
 template<typename K, typename V>
 ArraySeq<K> BSTMap<K,V>::sorted_keys() const{
-  ArraySeq<K> keyList;
+  ArraySeq<K> keyList(resource);
   sorted_keys(root, keyList);
   return keyList;
 } 
@@ -327,6 +443,54 @@ int BSTMap<K,V>::height() const{
   return height(root)+1;
 }
 
+template<typename K, typename V>
+std::pmr::memory_resource* BSTMap<K,V>::memory_resource() const{
+  return resource;
+}
+
+template<typename K, typename V>
+MemoryUsage BSTMap<K,V>::memory_usage() const{
+  MemoryUsage usage;
+  usage.payload = (long) count * (sizeof(K) + sizeof(V));
+  usage.overhead = (long) count * (sizeof(Node) - sizeof(K) - sizeof(V));
+  usage.metadata = sizeof(*this);
+  return usage;
+}
+
+template<typename K, typename V>
+void BSTMap<K,V>::insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values){
+  this->check_batch(batch_keys, batch_values);
+  FlatSeq<int> order = this->batch_order(batch_keys);
+  insert_sorted(root, batch_keys, batch_values, order, 0, order.size());
+}
+
+template<typename K, typename V>
+void BSTMap<K,V>::insert_sorted(Node*& link, const ArraySeq<K>& batch_keys,
+                                const ArraySeq<V>& batch_values,
+                                const FlatSeq<int>& order, int lo, int hi){
+  if(lo == hi){
+    return;
+  }
+  if(link == nullptr){
+    int mid = lo + (hi - lo) / 2;
+    int b = order.unchecked_at(mid);
+    link = make_node(batch_keys.unchecked_at(b), batch_values.unchecked_at(b), nullptr, nullptr);
+    count++;
+    insert_sorted(link->left, batch_keys, batch_values, order, lo, mid);
+    insert_sorted(link->right, batch_keys, batch_values, order, mid + 1, hi);
+    return;
+  }
+  // like insert, keys greater than the node's go right
+  const int* first = order.begin() + lo;
+  const int* split = std::upper_bound(first, order.begin() + hi, link->key,
+                                      [&batch_keys](const K& key, int b){
+                                        return key < batch_keys.unchecked_at(b);
+                                      });
+  int mid = lo + (split - first);
+  insert_sorted(link->left, batch_keys, batch_values, order, lo, mid);
+  insert_sorted(link->right, batch_keys, batch_values, order, mid, hi);
+}
+
 template<typename K, typename V>
 void BSTMap<K,V>::make_empty(Node* st_root){
   if(empty()){return;}
@@ -336,7 +500,7 @@ void BSTMap<K,V>::make_empty(Node* st_root){
   if(st_root->right != nullptr){
     make_empty(st_root->right);
   }
-  delete st_root; 
+  free_node(st_root);
   count--; 
   return;
 }
@@ -346,11 +510,7 @@ typename BSTMap<K,V>::Node* BSTMap<K,V>::copy(const Node* rhs_st_root) const{
   if(rhs_st_root == nullptr){
     return root;
   }
-  Node* temp = new Node;
-  temp->left = nullptr;
-  temp->right = nullptr;
-  temp->key = rhs_st_root->key;
-  temp->value = rhs_st_root->value;
+  Node* temp = make_node(rhs_st_root->key, rhs_st_root->value, nullptr, nullptr);
 
   if(rhs_st_root->left != nullptr){
     temp->left = copy(rhs_st_root->left);
@@ -368,12 +528,14 @@ typename BSTMap<K,V>::Node* BSTMap<K,V>::erase(const K& key, Node* st_root){
     if(st_root->left == nullptr){
       throw std:: out_of_range("BSTMap<K,V>::erase(const K& key");
     }
+    OP_COUNT(node_hops, 1);
     st_root->left = erase(key, st_root->left);
   }
   else if (key > st_root->key){
     if(st_root->right == nullptr){
       throw std:: out_of_range("BSTMap<K,V>::erase(const K& key");
     }
+    OP_COUNT(node_hops, 1);
     st_root->right = erase(key, st_root->right);
   }
   else if(key==st_root->key){
@@ -384,7 +546,7 @@ typename BSTMap<K,V>::Node* BSTMap<K,V>::erase(const K& key, Node* st_root){
       }
       st_root = st_root->right;
       count--;
-      delete temp;
+      free_node(temp);
       return st_root;
     }
     else if(st_root->right == nullptr){
@@ -393,30 +555,33 @@ typename BSTMap<K,V>::Node* BSTMap<K,V>::erase(const K& key, Node* st_root){
       }
       st_root = st_root->left;
       count--;
-      delete temp;
+      free_node(temp);
       return st_root;
     }
     else{
       temp = temp->right;
+      OP_COUNT(node_hops, 1);
       if(temp->left == nullptr){
         st_root->key = temp->key;
         st_root->value = temp->value;
         st_root->right = temp->right;
         count--;
-        delete temp;
+        free_node(temp);
         return st_root;
       }
       Node* before = temp;
       temp = temp->left;
+      OP_COUNT(node_hops, 1);
       while(temp->left != nullptr){
         before = before->left;
         temp = temp->left;
+        OP_COUNT(node_hops, 1);
       }
       st_root->key = temp->key;
       st_root->value = temp->value;
       before->left = temp->right;
       count--;
-      delete temp;
+      free_node(temp);
       return st_root;
     }
   }
@@ -474,4 +639,57 @@ int BSTMap<K,V>::height(const Node* st_root) const{
 }
 
 
+template<typename K, typename V>
+template<typename F>
+void BSTMap<K,V>::for_each(F visit){
+  walk(root, visit);
+}
+
+template<typename K, typename V>
+template<typename F>
+void BSTMap<K,V>::for_each(F visit) const{
+  walk(static_cast<const Node*>(root), visit);
+}
+
+template<typename K, typename V>
+template<typename F>
+void BSTMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit){
+  walk_range(root, k1, k2, visit);
+}
+
+template<typename K, typename V>
+template<typename F>
+void BSTMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+  walk_range(static_cast<const Node*>(root), k1, k2, visit);
+}
+
+template<typename K, typename V>
+template<typename NodeT, typename F>
+void BSTMap<K,V>::walk(NodeT* st_root, F& visit){
+  if(st_root == nullptr){
+    return;
+  }
+  walk(static_cast<NodeT*>(st_root->left), visit);
+  visit(static_cast<const K&>(st_root->key), st_root->value);
+  walk(static_cast<NodeT*>(st_root->right), visit);
+}
+
+template<typename K, typename V>
+template<typename NodeT, typename F>
+void BSTMap<K,V>::walk_range(NodeT* st_root, const K& k1, const K& k2, F& visit){
+  if(st_root == nullptr){
+    return;
+  }
+  // equal keys can be in the left subtree (see insert)
+  if(!(st_root->key < k1)){
+    walk_range(static_cast<NodeT*>(st_root->left), k1, k2, visit);
+  }
+  if(!(st_root->key < k1) && !(k2 < st_root->key)){
+    visit(static_cast<const K&>(st_root->key), st_root->value);
+  }
+  if(st_root->key < k2){
+    walk_range(static_cast<NodeT*>(st_root->right), k1, k2, visit);
+  }
+}
+
 #endif
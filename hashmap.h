@@ -4,34 +4,48 @@
 // DATE: Fall 2021
 // DESC: Hashmap implementation: uses a hash function, arrays, and linked list to 
 // implement hashmap
+// Ordered queries are served from a sorted copy of the keys that is
+// rebuilt only after a write (see sortedkeycache.h). The table, the
+// nodes and the key cache are allocated from a memory resource.
 //---------------------------------------------------------------------------
 
 #ifndef HASHMAP_H
 #define HASHMAP_H
 
 #include <functional>
+#include <memory_resource>
 #include "map.h"
 #include "arrayseq.h"
+#include "seqview.h"
+#include "memoryusage.h"
+#include "opcounters.h"
+#include "sortedkeycache.h"
 
 
 template<typename K, typename V>
-class HashMap : public Map<K,V>
+class HashMap final : public Map<K,V>
 {
 public:
 
   // default constructor
   HashMap();
 
-  // copy constructor
+  // Creates an empty map whose table, nodes and key cache (and the key
+  // lists find_keys and sorted_keys return) are allocated from the
+  // given memory resource
+  explicit HashMap(std::pmr::memory_resource* resource);
+
+  // copy constructor (the copy allocates from the default resource)
   HashMap(const HashMap& rhs);
 
-  // move constructor
+  // move constructor (takes over rhs's memory resource)
   HashMap(HashMap&& rhs);
 
   // copy assignment
   HashMap& operator=(const HashMap& rhs);
 
-  // move assignment
+  // move assignment (copies the pairs instead if the two maps'
+  // memory resources differ)
   HashMap& operator=(HashMap&& rhs);  
 
   // destructor
@@ -51,10 +65,31 @@ public:
   // given key is not in the collection. 
   const V& operator[](const K& key) const;
 
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws.
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
   // Extends the collection by adding the given key-value
   // pair. Assumes the key being added is not present in the
   // collection. Insert does not check if the key is present.
   void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
 
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
@@ -71,10 +106,41 @@ public:
   // Returns the keys in the collection in ascending sorted order
   ArraySeq<K> sorted_keys() const;  
 
+  // Returns a view of all the keys in ascending sorted order, without
+  // copying them. The view is valid until the map is modified.
+  SeqView<K> sorted_view() const;
+
+  // Calls visit(key, value) on every pair in table order (not
+  // sorted), without allocating. visit may modify the values, but
+  // must not otherwise modify the map.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2
+  // (still a walk over the whole table)
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+  // Grows the table once to fit the whole batch below the load
+  // factor, so the inserts that follow never rehash
+  void insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values);
+
   // statistics functions for the hash table implementation
   int min_chain_length() const;
   int max_chain_length() const;
   double avg_chain_length() const;
+
+  // Returns the memory resource the map allocates from
+  std::pmr::memory_resource* memory_resource() const;
+
+  // Returns the bytes the map uses (see memoryusage.h). Each node's
+  // next pointer and padding are overhead, and the bucket array and
+  // the sorted key cache are metadata.
+  MemoryUsage memory_usage() const;
   
 private:
 
@@ -93,9 +159,114 @@ private:
 
   // threshold for resize and rehash
   const double load_factor_threshold = 0.60;
+
+  // where the table and the nodes are allocated
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();
   
   // array of linked lists
-  Node** table = new Node*[capacity];
+  Node** table = nullptr;
+
+  // sorted copy of the keys for the ordered queries
+  mutable SortedKeyCache<K> key_cache{resource};
+
+  // helpers to allocate and free a node from the resource
+  template<typename... Args>
+  Node* make_node(Args&&... args){
+    void* mem = resource->allocate(sizeof(Node), alignof(Node));
+    try {
+      return new (mem) Node{std::forward<Args>(args)...};
+    }
+    catch(...) {
+      resource->deallocate(mem, sizeof(Node), alignof(Node));
+      throw;
+    }
+  }
+
+  void free_node(Node* node){
+    node->~Node();
+    resource->deallocate(node, sizeof(Node), alignof(Node));
+  }
+
+  // helpers to allocate a table of n empty chains, and to free one
+  Node** make_table(int n){
+    Node** newTable = static_cast<Node**>(resource->allocate(n * sizeof(Node*), alignof(Node*)));
+    std::fill(newTable, newTable + n, nullptr);
+    return newTable;
+  }
+
+  void free_table(Node** oldTable, int n){
+    resource->deallocate(oldTable, n * sizeof(Node*), alignof(Node*));
+  }
+
+  // helper to bring key_cache up to date
+  void update_key_cache() const{
+    key_cache.update(count, [this](FlatSeq<K>& sorted){
+      for(int i = 0; i < capacity; i++){
+        for(Node* temp = table[i]; temp != nullptr; temp = temp->next){
+          sorted.insert(temp->key, sorted.size());
+        }
+      }
+    });
+  }
+
+  // helper to find the node holding the key (nullptr if none)
+  Node* find_node(const K& key) const{
+    for(Node* temp = table[hash(key)]; temp != nullptr; temp = temp->next){
+      OP_COUNT(probes, 1);
+      if(temp->key == key){
+        return temp;
+      }
+    }
+    return nullptr;
+  }
+
+  // helper for both inserts: adds the pair at the front of the key's
+  // chain, constructing the node's key and value in place
+  template<typename KK, typename VV>
+  void insert_pair(KK&& key, VV&& value){
+    if((count * 1.0) / capacity >= load_factor_threshold){
+      resize_and_rehash();
+    }
+    int hash_index = hash(key);
+    table[hash_index] = make_node(std::forward<KK>(key), std::forward<VV>(value), table[hash_index]);
+    count++;
+    key_cache.invalidate();
+  }
+
+  // helper for the single-lookup inserts: returns the key's value
+  // if the key is in its chain, and otherwise adds the pair (key,
+  // make_value()) at the front of the chain. The key is only moved
+  // from (if it is an rvalue) when the pair is added.
+  template<typename KK, typename F>
+  std::pair<V*,bool> find_or_insert(KK&& key, F make_value){
+    int hash_index = hash(key);
+    for(Node* temp = table[hash_index]; temp != nullptr; temp = temp->next){
+      OP_COUNT(probes, 1);
+      if(temp->key == key){
+        return {&temp->value, false};
+      }
+    }
+    if((count * 1.0) / capacity >= load_factor_threshold){
+      resize_and_rehash();
+      hash_index = hash(key);
+    }
+    Node* newNode = make_node(std::forward<KK>(key), make_value(), table[hash_index]);
+    table[hash_index] = newNode;
+    count++;
+    key_cache.invalidate();
+    return {&newNode->value, true};
+  }
+
+  // helper for for_each and for_each_in_range: calls visit(key,
+  // value) on every pair in table order
+  template<typename F>
+  void walk(F&& visit) const{
+    for(int i = 0; i < capacity; i++){
+      for(Node* temp = table[i]; temp != nullptr; temp = temp->next){
+        visit(static_cast<const K&>(temp->key), temp->value);
+      }
+    }
+  }
 
   // the hash function
   int hash(const K& key) const{
@@ -105,52 +276,54 @@ private:
     return index;
   }
 
-  // resize and rehash the table
+  // resize and rehash the table (the nodes are relinked into the new
+  // table, so no keys or values are copied)
   void resize_and_rehash(){
+    rehash(capacity * 2);
+  }
+
+  // rehash the table into one of the given capacity
+  void rehash(int new_capacity){
     int oldCap = capacity;
-    capacity *= 2;
+    capacity = new_capacity;
     Node** oldTable = table;
-    Node** newTable = new Node*[capacity];
-    table = newTable;
-    init_table();
-    count = 0;
+    table = make_table(capacity);
 
     Node* temp = nullptr;
 
     for(int i = 0; i<oldCap; i++){
-      temp = oldTable[i];
       while(oldTable[i] != nullptr){
         temp = oldTable[i];
-        this->insert(temp->key, temp->value);
         oldTable[i] = temp->next;
-        delete temp;
+        int hash_index = hash(temp->key);
+        temp->next = table[hash_index];
+        table[hash_index] = temp;
       }
     }
-    delete[] oldTable;
-  }
-
-  // initialize the table to all nullptr
-  void init_table(){
-    for(int i = 0; i < capacity; i++){
-      table[i] = nullptr;
-    }
-    return;
+    free_table(oldTable, oldCap);
   }
   
-  // clean up the table and reset member variables
+  // clean up the nodes and the table and reset member variables
+  // (leaves no table, so the caller must make a new one)
   void make_empty(){
+    if(table == nullptr){
+      return;
+    }
     Node* temp = nullptr;
     for(int i = 0; i < capacity; i++){
       temp = table[i];
       while(table[i] != nullptr){
         temp = table[i];
         table[i] = temp->next;
-        delete temp;
+        free_node(temp);
       }
     }
+    free_table(table, capacity);
+    table = nullptr;
 
     count = 0;
     capacity = 16;
+    key_cache.invalidate();
     return;
   }
 };
@@ -161,10 +334,16 @@ template<typename K, typename V>
   HashMap<K,V>::HashMap(){
     count = 0;
     capacity = 16;
-    init_table();
+    table = make_table(capacity);
     return;
   }
 
+  template<typename K, typename V>
+  HashMap<K,V>::HashMap(std::pmr::memory_resource* resource)
+    : resource(resource){
+    table = make_table(capacity);
+  }
+
   // copy constructor
   template<typename K, typename V>
   HashMap<K,V>::HashMap(const HashMap& rhs){
@@ -174,7 +353,8 @@ template<typename K, typename V>
 
   // move constructor
   template<typename K, typename V>
- HashMap<K,V>::HashMap(HashMap&& rhs){
+ HashMap<K,V>::HashMap(HashMap&& rhs)
+    : resource(rhs.resource){
     *this = std::move(rhs);
   }
 
@@ -182,14 +362,11 @@ template<typename K, typename V>
   template<typename K, typename V>
   HashMap<K,V>& HashMap<K,V>::operator=(const HashMap& rhs){
     if(this != &rhs){
-      if(count > 0){
-        this->make_empty();
-      }
-      delete[] this->table;
+      this->make_empty();
       this->capacity = rhs.capacity;
-      this->table = new Node*[capacity];
-      this->init_table();
+      this->table = make_table(capacity);
       this->count = rhs.count;
+      this->key_cache = rhs.key_cache;
       if(rhs.empty()){
         return *this;
       }
@@ -197,11 +374,7 @@ template<typename K, typename V>
       for(int i = 0; i < capacity; i++){
         tempR = rhs.table[i];
         while(tempR != nullptr){
-          Node* newNode = new Node;
-          newNode->key = tempR->key;
-          newNode->value = tempR->value;
-          newNode->next = this->table[i];
-          this->table[i] = newNode;
+          this->table[i] = make_node(tempR->key, tempR->value, this->table[i]);
           tempR = tempR->next;
         }
       }
@@ -213,17 +386,19 @@ template<typename K, typename V>
   template<typename K, typename V>
   HashMap<K,V>& HashMap<K,V>::operator=(HashMap&& rhs){
     if(this != &rhs){
-      if(count>0){
-        this->make_empty();
+      if(!resource->is_equal(*rhs.resource)){
+        // rhs's table and nodes can't be freed through this resource
+        return *this = static_cast<const HashMap&>(rhs);
       }
-      delete[] this->table;
+      this->make_empty();
       this->capacity = rhs.capacity;
       this->count = rhs.count;
       this->table = rhs.table;
+      this->key_cache = std::move(rhs.key_cache);
+      rhs.key_cache.invalidate();
       rhs.count = 0;
       rhs.capacity = 16;
-      rhs.table = new Node*[capacity];
-      rhs.init_table();
+      rhs.table = rhs.make_table(rhs.capacity);
     }
     return *this;
   }
@@ -232,7 +407,6 @@ template<typename K, typename V>
   template<typename K, typename V>
   HashMap<K,V>::~HashMap(){
     this->make_empty();
-    delete[] this->table;
     return;
   }
   
@@ -258,38 +432,34 @@ template<typename K, typename V>
   // out_of_range if the given key is not in the collection.
   template<typename K, typename V>
   V& HashMap<K,V>::operator[](const K& key){
-    int hash_index = hash(key);
-    if(hash_index>= capacity or table[hash_index] == nullptr){
+    Node* node = find_node(key);
+    if(node == nullptr){
       throw std:: out_of_range("HashMap<K,V>::operator[](const K& key");
     }
-
-    Node* temp = table[hash_index];
-    while(temp != nullptr){
-      if(temp->key == key){
-        return temp->value;
-      }
-      temp = temp->next;
-    }
-    throw std:: out_of_range("HashMap<K,V>::operator[](const K& key");
+    return node->value;
   }
 
   // Returns the value for a given key. Throws out_of_range if the
   // given key is not in the collection. 
   template<typename K, typename V>
   const V& HashMap<K,V>::operator[](const K& key) const{
-    int hash_index = hash(key);
-    if(hash_index>= capacity or table[hash_index] == nullptr){
+    const Node* node = find_node(key);
+    if(node == nullptr){
       throw std:: out_of_range("HashMap<K,V>::operator[](const K& key");
     }
+    return node->value;
+  }
 
-    Node* temp = table[hash_index];
-    while(temp != nullptr){
-      if(temp->key == key){
-        return temp->value;
-      }
-      temp = temp->next;
-    }
-    throw std:: out_of_range("HashMap<K,V>::operator[](const K& key");
+  template<typename K, typename V>
+  V* HashMap<K,V>::find(const K& key) noexcept{
+    Node* node = find_node(key);
+    return node != nullptr ? &node->value : nullptr;
+  }
+
+  template<typename K, typename V>
+  const V* HashMap<K,V>::find(const K& key) const noexcept{
+    const Node* node = find_node(key);
+    return node != nullptr ? &node->value : nullptr;
   }
 
   // Extends the collection by adding the given key-value
@@ -297,28 +467,46 @@ template<typename K, typename V>
   // collection. Insert does not check if the key is present.
   template<typename K, typename V>
   void HashMap<K,V>::insert(const K& key, const V& value){
-    double total = (count * 1.0) / capacity;
-    if(total >= load_factor_threshold){
-      resize_and_rehash();
-    }
+    insert_pair(key, value);
+  }
 
-    int hash_index = hash(key);
-    Node* newNode = new Node;
-    newNode->value = value;
-    newNode->key = key;
-  
-    if(table[hash_index] == nullptr){
-      newNode->next = nullptr;
-      table[hash_index] = newNode;
+  template<typename K, typename V>
+  void HashMap<K,V>::insert(K&& key, V&& value){
+    insert_pair(std::move(key), std::move(value));
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> HashMap<K,V>::try_insert(const K& key, const V& value){
+    return find_or_insert(key, [&]() -> const V& {return value;});
+  }
+
+  template<typename K, typename V>
+  bool HashMap<K,V>::insert_or_assign(const K& key, const V& value){
+    std::pair<V*,bool> result = find_or_insert(key, [&]() -> const V& {return value;});
+    if(!result.second){
+      *result.first = value;
     }
-    else{
-      Node* temp = table[hash_index];
-      table[hash_index] = newNode;
-      newNode->next = temp;
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> HashMap<K,V>::try_insert(K&& key, V&& value){
+    return find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+  }
+
+  template<typename K, typename V>
+  bool HashMap<K,V>::insert_or_assign(K&& key, V&& value){
+    std::pair<V*,bool> result = find_or_insert(std::move(key), [&]() -> V&& {return std::move(value);});
+    if(!result.second){
+      *result.first = std::move(value);
     }
-    count++;
-    
-    return;
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> HashMap<K,V>::emplace(KK&& key, Args&&... args){
+    return find_or_insert(std::forward<KK>(key), [&]() {return V(std::forward<Args>(args)...);});
   }
 
   // Shrinks the collection by removing the key-value pair with the
@@ -332,21 +520,19 @@ template<typename K, typename V>
     Node* temp = table[hash_index];
     Node* before = nullptr;
     while(temp != nullptr){
+      OP_COUNT(probes, 1);
       if(temp->key == key){
         if(temp == table[hash_index]){
           table[hash_index] = temp->next;
-          delete temp;
-          count--;
-          return;
-        }
-        if(temp->next == nullptr){
-          delete temp;
+          free_node(temp);
           count--;
+          key_cache.invalidate();
           return;
         }
         before->next = temp->next;
-        delete temp;
+        free_node(temp);
         count--;
+        key_cache.invalidate();
         return;
       }
       before = temp;
@@ -359,52 +545,42 @@ template<typename K, typename V>
   // Returns true if the key is in the collection, and false otherwise.
   template<typename K, typename V>
   bool HashMap<K,V>::contains(const K& key) const{
-    int hash_index = hash(key);
-    if(hash_index>= capacity or table[hash_index] == nullptr){
-     return false;
-    }
-
-    Node* temp = table[hash_index];
-    while(temp != nullptr){
-      if(temp->key == key){
-        return true;
-      }
-      temp = temp->next;
-    }
-    return false;
+    return find_node(key) != nullptr;
   }
 
   // Returns the keys k in the collection such that k1 <= k <= k2
   template<typename K, typename V>
   ArraySeq<K> HashMap<K,V>::find_keys(const K& k1, const K& k2) const{
-    ArraySeq<K> keyList;
-    Node* temp = nullptr;
-    for(int i = 0; i < capacity; i++){
-      temp = table[i];
-      while(temp != nullptr){
-        if(temp->key >= k1 and temp->key <= k2){
-          keyList.insert(temp->key,keyList.size());
-        }
-        temp = temp->next;
-      }
+    update_key_cache();
+    return key_cache.range(k1, k2);
+  }
+
+  template<typename K, typename V>
+  void HashMap<K,V>::insert_batch(const ArraySeq<K>& batch_keys, const ArraySeq<V>& batch_values){
+    this->check_batch(batch_keys, batch_values);
+    int new_capacity = capacity;
+    while(((count + batch_keys.size()) * 1.0) / new_capacity >= load_factor_threshold){
+      new_capacity *= 2;
+    }
+    if(new_capacity > capacity){
+      rehash(new_capacity);
+    }
+    for(int i = 0; i < batch_keys.size(); i++){
+      insert_pair(batch_keys.unchecked_at(i), batch_values.unchecked_at(i));
     }
-    return keyList;
   }
 
   // Returns the keys in the collection in ascending sorted order
   template<typename K, typename V>
   ArraySeq<K> HashMap<K,V>::sorted_keys() const{
-    ArraySeq<K> keyList;
-    Node* temp = nullptr;
-    for(int i = 0; i < capacity; i++){
-      temp = table[i];
-      while(temp != nullptr){
-        keyList.insert(temp->key,keyList.size());
-        temp = temp->next;
-      }
-    }
-    keyList.merge_sort();
-    return keyList;
+    update_key_cache();
+    return key_cache.all();
+  }
+
+  template<typename K, typename V>
+  SeqView<K> HashMap<K,V>::sorted_view() const{
+    update_key_cache();
+    return key_cache.view();
   }
 
   // statistics functions for the hash table implementation
@@ -469,7 +645,54 @@ template<typename K, typename V>
     if(withNodes == 0) {return 0;}
     return total/withNodes;
   }
+
+  template<typename K, typename V>
+  std::pmr::memory_resource* HashMap<K,V>::memory_resource() const{
+    return resource;
+  }
+
+  template<typename K, typename V>
+  MemoryUsage HashMap<K,V>::memory_usage() const{
+    MemoryUsage usage;
+    usage.payload = (long) count * (sizeof(K) + sizeof(V));
+    usage.overhead = (long) count * (sizeof(Node) - sizeof(K) - sizeof(V));
+    usage.metadata = sizeof(*this) - sizeof(key_cache) + (long) capacity * sizeof(Node*);
+    usage += key_cache.memory_usage().as_metadata();
+    return usage;
+  }
   
 
 
+  template<typename K, typename V>
+  template<typename F>
+  void HashMap<K,V>::for_each(F visit){
+    walk(visit);
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void HashMap<K,V>::for_each(F visit) const{
+    walk([&visit](const K& key, const V& value){visit(key, value);});
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void HashMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit){
+    walk([&](const K& key, V& value){
+      if(!(key < k1) && !(k2 < key)){
+        visit(key, value);
+      }
+    });
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void HashMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+    walk([&](const K& key, const V& value){
+      if(!(key < k1) && !(k2 < key)){
+        visit(key, value);
+      }
+    });
+  }
+
 #endif
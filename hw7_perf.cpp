@@ -9,7 +9,9 @@
 //       save this data to a file, run the command:
 //          ./hw7_perf > output.dat
 //       This file can then be used by the plotting script to generate
-//       the corresponding performance graphs.
+//       the corresponding performance graphs. The hw7_perf_counts
+//       build (compiled with OP_COUNTERS, see opcounters.h) instead
+//       prints each map's operation counts per call.
 //---------------------------------------------------------------------------
 
 #include <iostream>
@@ -26,23 +28,33 @@
 #include "binsearchmap.h"
 #include "hashmap.h"
 #include "bstmap.h"
+#include "blockedsortedmap.h"
+#include "opcounters.h"
 
 
 using namespace std;
 using namespace std::chrono;
 
 
-double timed_insert(Map<int,int>& m, int key);
-double timed_erase(Map<int,int>& m, int key);
-double timed_contains(const Map<int,int>& m, int key);
-double timed_find_range(const Map<int,int>& m, int key1, int key2);
-double timed_sorted_keys(const Map<int,int>& m);
+// Each timing helper is a template over the concrete map type so the
+// timed calls are statically dispatched (the maps are final).
+template<typename MapT> double timed_insert(MapT& m, int key);
+template<typename MapT> double timed_erase(MapT& m, int key);
+template<typename MapT> double timed_contains(const MapT& m, int key);
+template<typename MapT> double timed_find_range(const MapT& m, int key1, int key2);
+template<typename MapT> double timed_sorted_keys(const MapT& m);
+template<typename MapT> double memory_kib(const MapT& m);
+template<typename MapT> double extra_bytes_per_pair(const MapT& m);
+template<typename MapT> void print_op_counts(int n, const string& name, MapT& m,
+                                             const ArraySeq<int>& keys);
+void print_op_counts();
 
 // test parameters
 const int start = 0;
 const int step = 15000;
 const int stop = 150000; 
 const int runs = 1;
+const int count_calls = 100;
 
 
 int main(int argc, char* argv[])
@@ -51,6 +63,11 @@ int main(int argc, char* argv[])
   cout << fixed << showpoint;
   cout << setprecision(2);
 
+  if (op_counters_enabled) {
+    print_op_counts();
+    return 0;
+  }
+
   // output data header
   cout << "# All times in milliseconds (msec)" << endl;
   cout << "# Column 1 = input data size" << endl;
@@ -83,6 +100,24 @@ int main(int argc, char* argv[])
   cout << "# Column 22 = bst map height shuffled" << endl;
   cout << "# Column 23 = log base 2 of input size" << endl;  
 
+  cout << "# Column 24 = blocked sorted map insert shuffled" << endl;
+  cout << "# Column 25 = blocked sorted map erase shuffled" << endl;
+  cout << "# Column 26 = blocked sorted map contains shuffled" << endl;
+  cout << "# Column 27 = blocked sorted map find range shuffled" << endl;
+  cout << "# Column 28 = blocked sorted map sorted keys shuffled" << endl;
+
+  cout << "# Column 29 = binsearch map memory (KiB)" << endl;
+  cout << "# Column 30 = array map memory (KiB)" << endl;
+  cout << "# Column 31 = hash map memory (KiB)" << endl;
+  cout << "# Column 32 = bst map memory (KiB)" << endl;
+  cout << "# Column 33 = blocked sorted map memory (KiB)" << endl;
+
+  cout << "# Column 34 = binsearch map bytes per pair beyond the payload" << endl;
+  cout << "# Column 35 = array map bytes per pair beyond the payload" << endl;
+  cout << "# Column 36 = hash map bytes per pair beyond the payload" << endl;
+  cout << "# Column 37 = bst map bytes per pair beyond the payload" << endl;
+  cout << "# Column 38 = blocked sorted map bytes per pair beyond the payload" << endl;
+
   // generate shuffled data
   ArraySeq<int> keys, vals;
   for (int i = 2; i <= stop*2; i += 2) {
@@ -99,11 +134,13 @@ int main(int argc, char* argv[])
     ArrayMap<int,int> m2;
     HashMap<int,int> m3;
     BSTMap<int,int> m4;
+    BlockedSortedMap<int,int> m5;
     for (int i = 0; i < n; ++i) {
       m1.insert(keys[i], vals[i]);
       m2.insert(keys[i], vals[i]);
       m3.insert(keys[i], vals[i]);
       m4.insert(keys[i], vals[i]);
+      m5.insert(keys[i], vals[i]);
     }
 
     int c22 = m4.height();
@@ -128,29 +165,47 @@ int main(int argc, char* argv[])
     double c8 = timed_erase(m3, med + 1);
     double c5 = timed_insert(m4, med + 1);
     double c9 = timed_erase(m4, med + 1);
+    double c24 = timed_insert(m5, med + 1);
+    double c25 = timed_erase(m5, med + 1);
     
     assert(m1.size() == n);
     assert(m2.size() == n);
     assert(m3.size() == n);
     assert(m4.size() == n);
+    assert(m5.size() == n);
     
     // contains end
     double c10 = timed_contains(m1, max + 1);
     double c11 = timed_contains(m2, max + 1);
     double c12 = timed_contains(m3, max + 1);
     double c13 = timed_contains(m4, max + 1);
+    double c26 = timed_contains(m5, max + 1);
 
     // key range (1/20th of values)
     double c14 = timed_find_range(m1, med, med + (n/20));
     double c15 = timed_find_range(m2, med, med + (n/20));
     double c16 = timed_find_range(m3, med, med + (n/20));
     double c17 = timed_find_range(m4, med, med + (n/20));
+    double c27 = timed_find_range(m5, med, med + (n/20));
     
     // sort
     double c18 = timed_sorted_keys(m1);
     double c19 = timed_sorted_keys(m2);
     double c20 = timed_sorted_keys(m3);
     double c21 = timed_sorted_keys(m4);
+    double c28 = timed_sorted_keys(m5);
+
+    // memory (after the queries, so the key caches are built)
+    double c29 = memory_kib(m1);
+    double c30 = memory_kib(m2);
+    double c31 = memory_kib(m3);
+    double c32 = memory_kib(m4);
+    double c33 = memory_kib(m5);
+    double c34 = extra_bytes_per_pair(m1);
+    double c35 = extra_bytes_per_pair(m2);
+    double c36 = extra_bytes_per_pair(m3);
+    double c37 = extra_bytes_per_pair(m4);
+    double c38 = extra_bytes_per_pair(m5);
 
     cout << n
          << " " << c2 << " " << c3 << " " << c4
@@ -160,7 +215,12 @@ int main(int argc, char* argv[])
          << " " << c14 << " " << c15 << " " << c16
          << " " << c17 << " " << c18 << " " << c19
          << " " << c20 << " " << c21 << " " << c22
-         << " " << c23 
+         << " " << c23 << " " << c24 << " " << c25
+         << " " << c26 << " " << c27 << " " << c28
+         << " " << c29 << " " << c30 << " " << c31
+         << " " << c32 << " " << c33 << " " << c34
+         << " " << c35 << " " << c36 << " " << c37
+         << " " << c38
          << endl;
   }
   
@@ -168,8 +228,10 @@ int main(int argc, char* argv[])
 
 
 // assumes keys are multiples of 2 and key to insert is odd
-double timed_insert(Map<int,int>& m, int key)
+template<typename MapT>
+double timed_insert(MapT& m, int key)
 {
+  static_assert(is_map_of<MapT,int,int>, "timing helpers require a Map<int,int>");
   double total = 0;
   for (int r = 0; r < runs; ++r) {
     auto t0 = high_resolution_clock::now();
@@ -181,8 +243,10 @@ double timed_insert(Map<int,int>& m, int key)
 }
 
 // removes the odd values inserted from timed_insert
-double timed_erase(Map<int,int>& m, int key)
+template<typename MapT>
+double timed_erase(MapT& m, int key)
 {
+  static_assert(is_map_of<MapT,int,int>, "timing helpers require a Map<int,int>");
   double total = 0;
   for (int r = 0; r < runs; ++r) {
     auto t0 = high_resolution_clock::now();
@@ -193,8 +257,10 @@ double timed_erase(Map<int,int>& m, int key)
   return (total/1000) / runs;
 }
 
-double timed_contains(const Map<int,int>& m, int key) 
+template<typename MapT>
+double timed_contains(const MapT& m, int key)
 {
+  static_assert(is_map_of<MapT,int,int>, "timing helpers require a Map<int,int>");
   double total = 0;
   for (int r = 0; r < runs; ++r) {
     auto t0 = high_resolution_clock::now();
@@ -205,8 +271,10 @@ double timed_contains(const Map<int,int>& m, int key)
   return (total/1000) / runs;
 }
 
-double timed_find_range(const Map<int,int>& m, int key1, int key2)
+template<typename MapT>
+double timed_find_range(const MapT& m, int key1, int key2)
 {
+  static_assert(is_map_of<MapT,int,int>, "timing helpers require a Map<int,int>");
   double total = 0;
   for (int r = 0; r < runs; ++r) {
     auto t0 = high_resolution_clock::now();
@@ -217,8 +285,10 @@ double timed_find_range(const Map<int,int>& m, int key1, int key2)
   return (total/1000) / runs;
 }
 
-double timed_sorted_keys(const Map<int,int>& m)
+template<typename MapT>
+double timed_sorted_keys(const MapT& m)
 {
+  static_assert(is_map_of<MapT,int,int>, "timing helpers require a Map<int,int>");
   double total = 0;
   for (int r = 0; r < runs; ++r) {
     auto t0 = high_resolution_clock::now();
@@ -229,6 +299,92 @@ double timed_sorted_keys(const Map<int,int>& m)
   return (total/1000) / runs;
 }
 
+template<typename MapT>
+double memory_kib(const MapT& m)
+{
+  static_assert(is_map_of<MapT,int,int>, "memory helpers require a Map<int,int>");
+  return m.memory_usage().total() / 1024.0;
+}
+
+// the overhead, slack and metadata bytes, spread over the pairs
+template<typename MapT>
+double extra_bytes_per_pair(const MapT& m)
+{
+  static_assert(is_map_of<MapT,int,int>, "memory helpers require a Map<int,int>");
+  if (m.size() == 0)
+    return 0;
+  MemoryUsage usage = m.memory_usage();
+  return (double) (usage.total() - usage.payload) / m.size();
+}
+
+
+// Prints the operation counts per call (see opcounters.h) of insert,
+// erase, and contains, one line per input size, map, and operation
+void print_op_counts()
+{
+  cout << "# Operation counts per call (average of " << count_calls << " calls)" << endl;
+  cout << "# Column 1 = input data size" << endl;
+  cout << "# Column 2 = map (binsearch, array, hash, bst, blocked)" << endl;
+  cout << "# Column 3 = operation (insert, erase, contains)" << endl;
+  cout << "# Column 4 = key comparisons" << endl;
+  cout << "# Column 5 = hash chain links walked" << endl;
+  cout << "# Column 6 = tree node hops" << endl;
+  cout << "# Column 7 = array elements shifted" << endl;
 
+  // same shuffled data as the timing runs
+  ArraySeq<int> keys;
+  for (int i = 2; i <= stop*2; i += 2)
+    keys.insert(i, keys.size());
+  faro_shuffle(keys, 7);
 
+  for (int n = start; n <= stop; n += step) {
+    BinSearchMap<int,int> m1;
+    ArrayMap<int,int> m2;
+    HashMap<int,int> m3;
+    BSTMap<int,int> m4;
+    BlockedSortedMap<int,int> m5;
+    for (int i = 0; i < n; ++i) {
+      m1.insert(keys[i], keys[i]);
+      m2.insert(keys[i], keys[i]);
+      m3.insert(keys[i], keys[i]);
+      m4.insert(keys[i], keys[i]);
+      m5.insert(keys[i], keys[i]);
+    }
+    print_op_counts(n, "binsearch", m1, keys);
+    print_op_counts(n, "array", m2, keys);
+    print_op_counts(n, "hash", m3, keys);
+    print_op_counts(n, "bst", m4, keys);
+    print_op_counts(n, "blocked", m5, keys);
+  }
+}
 
+// inserts and erases odd keys from the middle of the range, and looks
+// up keys spread over the first n shuffled keys (the ones in the map,
+// so every lookup hits if n > 0)
+template<typename MapT>
+void print_op_counts(int n, const string& name, MapT& m, const ArraySeq<int>& keys)
+{
+  static_assert(is_map_of<MapT,int,int>, "counting helpers require a Map<int,int>");
+  OpCounters counts[3];
+  op_counters().reset();
+  for (int r = 0; r < count_calls; ++r)
+    m.insert(n + 1 + (r * 2), r);
+  counts[0] = op_counters();
+  op_counters().reset();
+  for (int r = 0; r < count_calls; ++r)
+    m.erase(n + 1 + (r * 2));
+  counts[1] = op_counters();
+  op_counters().reset();
+  for (int r = 0; r < count_calls; ++r)
+    m.contains(n == 0 ? 1 : keys[(r * 7919) % n]);
+  counts[2] = op_counters();
+  const char* ops[3] = {"insert", "erase", "contains"};
+  for (int op = 0; op < 3; ++op) {
+    cout << n << " " << name << " " << ops[op]
+         << " " << (double) counts[op].comparisons / count_calls
+         << " " << (double) counts[op].probes / count_calls
+         << " " << (double) counts[op].node_hops / count_calls
+         << " " << (double) counts[op].moves / count_calls
+         << endl;
+  }
+}
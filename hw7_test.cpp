@@ -7,9 +7,32 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <random>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
+#include <memory_resource>
 #include <gtest/gtest.h>
+#include "util.h"
 #include "arrayseq.h"
+#include "tieredseq.h"
+#include "arraymap.h"
+#include "binsearchmap.h"
+#include "searchpolicy.h"
+#include "learnedindex.h"
+#include "hashmap.h"
+#include "adaptivemap.h"
+#include "blockedsortedmap.h"
 #include "bstmap.h"
+#include "persistentbstmap.h"
+#include "snapshot.h"
+#include "opcounters.h"
 
 using namespace std;
 
@@ -367,6 +390,1833 @@ TEST(BasicBSTMapTests, HeightCheck)
 }
 
 
+//----------------------------------------------------------------------
+// ArraySeq linear search and ArrayMap Tests
+//----------------------------------------------------------------------
+
+TEST(ArraySeqSearchTests, IndexOfIntCheck)
+{
+  ArraySeq<int> s;
+  for (int i = 0; i < 100; ++i)
+    s.insert(i * 3, i);
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(i, s.index_of(i * 3));
+  ASSERT_EQ(-1, s.index_of(1));
+  ASSERT_EQ(-1, s.index_of(300));
+  ASSERT_EQ(true, s.contains(297));
+  ASSERT_EQ(false, s.contains(298));
+}
+
+TEST(ArraySeqSearchTests, IndexOfLongCheck)
+{
+  ArraySeq<long> s;
+  for (int i = 0; i < 37; ++i)
+    s.insert((long)i << 33, i);
+  for (int i = 0; i < 37; ++i)
+    ASSERT_EQ(i, s.index_of((long)i << 33));
+  // low halves match but high halves do not
+  ASSERT_EQ(-1, s.index_of(1L << 32));
+  ASSERT_EQ(-1, s.index_of(5));
+}
+
+TEST(ArraySeqSearchTests, IndexOfFirstDuplicateCheck)
+{
+  ArraySeq<int> s;
+  for (int i = 0; i < 40; ++i)
+    s.insert(i % 20, i);
+  ASSERT_EQ(7, s.index_of(7));
+  ArraySeq<char> c;
+  ASSERT_EQ(-1, c.index_of('a'));
+  c.insert('a', 0);
+  c.insert('b', 1);
+  ASSERT_EQ(1, c.index_of('b'));
+}
+
+TEST(BasicArrayMapTests, InsertEraseAccessCheck)
+{
+  ArrayMap<int,int> m;
+  for (int i = 0; i < 50; ++i)
+    m.insert(i, i * 10);
+  ASSERT_EQ(50, m.size());
+  ASSERT_EQ(250, m[25]);
+  m[25] = 7;
+  ASSERT_EQ(7, m[25]);
+  m.erase(10);
+  ASSERT_EQ(49, m.size());
+  ASSERT_EQ(false, m.contains(10));
+  ASSERT_EQ(110, m[11]);
+  EXPECT_THROW(m.erase(10), std::out_of_range);
+  ArraySeq<int> k = m.find_keys(8, 12);
+  ASSERT_EQ(4, k.size());
+  k = m.sorted_keys();
+  ASSERT_EQ(49, k.size());
+  for (int i = 1; i < k.size(); ++i)
+    ASSERT_LT(k[i-1], k[i]);
+}
+
+
+TEST(ArraySeqSearchTests, RawIteratorCheck)
+{
+  ArraySeq<int> s;
+  for (int i = 0; i < 10; ++i)
+    s.insert(10 - i, i);
+  ASSERT_EQ(10, s.end() - s.begin());
+  ASSERT_EQ(s.data(), s.begin());
+  std::sort(s.begin(), s.end());
+  for (int i = 0; i < 10; ++i)
+    ASSERT_EQ(i + 1, s.unchecked_at(i));
+  int total = 0;
+  for (int x : s)
+    total += x;
+  ASSERT_EQ(55, total);
+}
+
+TEST(ArraySeqSearchTests, FaroShuffleOverloadCheck)
+{
+  ArraySeq<int> s1, s2;
+  load_in_order(s1, 100);
+  load_in_order(s2, 100);
+  Sequence<int>& generic = s2;
+  faro_shuffle(s1, 5);
+  faro_shuffle(generic, 5);
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(s2[i], s1[i]);
+}
+
+
+TEST(ArraySeqInlineTests, InlineThenSpillCheck)
+{
+  ArraySeq<int,4> s;
+  const char* obj = reinterpret_cast<const char*>(&s);
+  const char* data = reinterpret_cast<const char*>(s.data());
+  // elements start out inside the object
+  ASSERT_EQ(true, data >= obj && data < obj + sizeof(s));
+  for (int i = 0; i < 4; ++i)
+    s.insert(i, i);
+  ASSERT_EQ(data, reinterpret_cast<const char*>(s.data()));
+  s.insert(4, 4);
+  ASSERT_NE(data, reinterpret_cast<const char*>(s.data()));
+  ASSERT_EQ(5, s.size());
+  for (int i = 0; i < 5; ++i)
+    ASSERT_EQ(i, s[i]);
+  EXPECT_THROW(s.insert(9, 7), std::out_of_range);
+}
+
+TEST(ArraySeqInlineTests, CopyAndMoveCheck)
+{
+  ArraySeq<int,4> small, big;
+  small.insert(1, 0);
+  small.insert(2, 1);
+  for (int i = 0; i < 10; ++i)
+    big.insert(i, i);
+  ArraySeq<int,4> c1(small), c2(big);
+  ASSERT_EQ(2, c1.size());
+  ASSERT_EQ(10, c2.size());
+  ArraySeq<int,4> m1(std::move(small)), m2(std::move(big));
+  ASSERT_EQ(0, small.size());
+  ASSERT_EQ(0, big.size());
+  ASSERT_EQ(2, m1[1]);
+  ASSERT_EQ(9, m2[9]);
+  m1 = std::move(m2);
+  ASSERT_EQ(10, m1.size());
+  m2 = c1;
+  ASSERT_EQ(2, m2.size());
+  m2.insert(3, 2);
+  ASSERT_EQ(3, m2[2]);
+  ASSERT_EQ(2, c1.size());
+}
+
+TEST(ArraySeqInlineTests, NoInlineReserveCheck)
+{
+  ArraySeq<int,0> s;
+  ASSERT_EQ(nullptr, s.data());
+  s.reserve(100);
+  const int* data = s.data();
+  for (int i = 0; i < 100; ++i)
+    s.insert(i, i);
+  ASSERT_EQ(data, s.data());
+}
+
+
+//----------------------------------------------------------------------
+// TieredSeq Tests
+//----------------------------------------------------------------------
+
+TEST(TieredSeqTests, AppendAndIndexCheck)
+{
+  TieredSeq<int> s;
+  ASSERT_EQ(true, s.empty());
+  for (int i = 0; i < 1000; ++i)
+    s.insert(i, i);
+  ASSERT_EQ(1000, s.size());
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_EQ(i, s[i]);
+  EXPECT_THROW(s[1000], std::out_of_range);
+  EXPECT_THROW(s.insert(0, 1001), std::out_of_range);
+  EXPECT_THROW(s.erase(-1), std::out_of_range);
+}
+
+TEST(TieredSeqTests, RandomInsertEraseCheck)
+{
+  TieredSeq<int> s;
+  std::vector<int> v;
+  std::mt19937 gen(223);
+  for (int r = 0; r < 5000; ++r) {
+    if (v.empty() || gen() % 3 != 0) {
+      int i = gen() % (v.size() + 1);
+      s.insert(r, i);
+      v.insert(v.begin() + i, r);
+    }
+    else {
+      int i = gen() % v.size();
+      s.erase(i);
+      v.erase(v.begin() + i);
+    }
+  }
+  // shrink back down through the smaller block sizes
+  while (v.size() > 3) {
+    int i = gen() % v.size();
+    s.erase(i);
+    v.erase(v.begin() + i);
+  }
+  ASSERT_EQ((int)v.size(), s.size());
+  for (int i = 0; i < s.size(); ++i)
+    ASSERT_EQ(v[i], s[i]);
+}
+
+TEST(TieredSeqTests, CopyMoveSortCheck)
+{
+  TieredSeq<int> s1;
+  for (int i = 0; i < 100; ++i)
+    s1.insert(i, 0);
+  TieredSeq<int> s2(s1);
+  s2.sort();
+  ASSERT_EQ(99, s1[0]);
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(i, s2[i]);
+  ASSERT_EQ(true, s1.contains(42));
+  TieredSeq<int> s3(std::move(s2));
+  ASSERT_EQ(0, s2.size());
+  ASSERT_EQ(100, s3.size());
+  s2 = s3;
+  s3 = std::move(s1);
+  ASSERT_EQ(99, s3[0]);
+  ASSERT_EQ(0, s2[0]);
+}
+
+TEST(TieredSeqTests, BinSearchMapBackingCheck)
+{
+  BinSearchMap<int,int,TieredSeq> m;
+  for (int i = 0; i < 500; ++i)
+    m.insert((i * 37) % 500, i);
+  ASSERT_EQ(500, m.size());
+  for (int i = 0; i < 500; ++i)
+    ASSERT_EQ(true, m.contains(i));
+  ASSERT_EQ(1, m[37]);
+  for (int i = 0; i < 500; i += 2)
+    m.erase(i);
+  ASSERT_EQ(250, m.size());
+  ASSERT_EQ(false, m.contains(10));
+  ArraySeq<int> k = m.sorted_keys();
+  ASSERT_EQ(250, k.size());
+  for (int i = 0; i < 250; ++i)
+    ASSERT_EQ(2 * i + 1, k[i]);
+}
+
+
+//----------------------------------------------------------------------
+// BinSearchMap Tests
+//----------------------------------------------------------------------
+
+// a 64-byte value type
+struct Payload {
+  long words[8];
+  bool operator==(const Payload& rhs) const {return words[0] == rhs.words[0];}
+  bool operator<(const Payload& rhs) const {return words[0] < rhs.words[0];}
+};
+
+TEST(BasicBinSearchMapTests, LargeValueCheck)
+{
+  BinSearchMap<int,Payload> m;
+  for (int i = 0; i < 200; ++i) {
+    Payload p;
+    for (int j = 0; j < 8; ++j)
+      p.words[j] = i * 8 + j;
+    m.insert((i * 71) % 200, p);
+  }
+  ASSERT_EQ(200, m.size());
+  for (int i = 0; i < 200; ++i) {
+    int k = (i * 71) % 200;
+    ASSERT_EQ(i * 8 + 7, m[k].words[7]);
+  }
+  m.erase(71);
+  ASSERT_EQ(false, m.contains(71));
+  ASSERT_EQ(16, m[142].words[0]);
+  EXPECT_THROW(m[71], std::out_of_range);
+}
+
+
+TEST(BasicBinSearchMapTests, KeyRangeCheck)
+{
+  BinSearchMap<int,int> m;
+  for (int i = 10; i >= 1; --i)
+    m.insert(i * 10, i);
+  ArraySeq<int> k = m.find_keys(25, 55);
+  ASSERT_EQ(3, k.size());
+  for (int i = 0; i < 3; ++i)
+    ASSERT_EQ(30 + i * 10, k[i]);
+  k = m.find_keys(30, 50);
+  ASSERT_EQ(3, k.size());
+  k = m.find_keys(0, 5);
+  ASSERT_EQ(0, k.size());
+  k = m.find_keys(101, 200);
+  ASSERT_EQ(0, k.size());
+  k = m.find_keys(0, 1000);
+  ASSERT_EQ(10, k.size());
+  ASSERT_EQ(true, m.contains(10) && m.contains(100));
+  ASSERT_EQ(false, m.contains(5) || m.contains(105) || m.contains(55));
+}
+
+
+// random inserts, erases, and lookups checked against std::map
+template<typename M>
+void check_against_std_map(M& m, int ops)
+{
+  std::map<int,int> expected;
+  std::mt19937 gen(7);
+  for (int r = 0; r < ops; ++r) {
+    int key = gen() % 500;
+    int op = gen() % 4;
+    if (op <= 1 && expected.count(key) == 0) {
+      m.insert(key, r);
+      expected[key] = r;
+    }
+    else if (op == 2 && expected.count(key) == 1) {
+      m.erase(key);
+      expected.erase(key);
+    }
+    else if (expected.count(key) == 1) {
+      ASSERT_EQ(expected[key], m[key]);
+      m[key] = -r;
+      expected[key] = -r;
+    }
+    else {
+      ASSERT_EQ(false, m.contains(key));
+      EXPECT_THROW(m.erase(key), std::out_of_range);
+    }
+    ASSERT_EQ((int)expected.size(), m.size());
+  }
+  ArraySeq<int> k = m.sorted_keys();
+  ASSERT_EQ((int)expected.size(), k.size());
+  int i = 0;
+  for (auto& kv : expected) {
+    ASSERT_EQ(kv.first, k[i++]);
+    ASSERT_EQ(kv.second, m[kv.first]);
+  }
+  k = m.find_keys(100, 199);
+  ASSERT_EQ((int)std::distance(expected.lower_bound(100), expected.upper_bound(199)),
+            k.size());
+}
+
+TEST(BasicBinSearchMapTests, BufferedWritesCheck)
+{
+  BinSearchMap<int,int> m1;
+  check_against_std_map(m1, 20000);
+  BinSearchMap<int,int,TieredSeq> m2;
+  check_against_std_map(m2, 20000);
+}
+
+TEST(BasicBinSearchMapTests, FlushCheck)
+{
+  BinSearchMap<int,int> m;
+  for (int i = 0; i < 10; ++i)
+    m.insert(i, i);
+  m.erase(3);
+  m.insert(3, 30);
+  m.erase(4);
+  m.flush();
+  ASSERT_EQ(9, m.size());
+  ASSERT_EQ(30, m[3]);
+  ASSERT_EQ(false, m.contains(4));
+  m.flush();
+  ASSERT_EQ(9, m.size());
+}
+
+TEST(BasicBinSearchMapTests, ConstQueriesKeepBufferCheck)
+{
+  BinSearchMap<int,int> m;
+  const BinSearchMap<int,int>& cm = m;
+  std::map<int,int> expected;
+  for (int i = 0; i < 200; ++i) {
+    int key = (i * 37) % 150;
+    if (i % 5 == 4 && expected.count(key)) {
+      m.erase(key);
+      expected.erase(key);
+    }
+    else {
+      m.insert(key, i);
+      expected[key] = i;
+    }
+    ASSERT_EQ((int)expected.size(), cm.size());
+    // const queries merge the buffer into their results
+    ArraySeq<int> k = cm.find_keys(20, 90);
+    auto it = expected.lower_bound(20);
+    for (int j = 0; j < k.size(); ++j, ++it)
+      ASSERT_EQ(it->first, k[j]);
+    ASSERT_EQ(expected.upper_bound(90), it);
+    int visited = 0;
+    it = expected.begin();
+    cm.for_each([&](const int& key, const int& value){
+      ASSERT_EQ(it->first, key);
+      ASSERT_EQ(it->second, value);
+      ++it;
+      ++visited;
+    });
+    ASSERT_EQ((int)expected.size(), visited);
+    ASSERT_EQ((int)expected.size(), cm.sorted_keys().size());
+    ASSERT_EQ((int)expected.size(), cm.size());
+  }
+  ArraySeq<int> probe;
+  for (int key = 0; key < 160; ++key)
+    probe.insert(key, key);
+  ArraySeq<bool> found = cm.contains_batch(probe);
+  for (int key = 0; key < 160; ++key)
+    ASSERT_EQ(expected.count(key) == 1, found[key]);
+}
+
+TEST(BasicBinSearchMapTests, ConstQueriesKeepReferencesCheck)
+{
+  BinSearchMap<int,int> m;
+  const BinSearchMap<int,int>& cm = m;
+  for (int i = 0; i < 100; ++i)
+    m.insert(i, i);
+  m.flush();
+  // 105 is only in the write buffer, and a const query must not move it
+  m.insert(105, 0);
+  int& r = m[105];
+  ASSERT_EQ(101, cm.sorted_keys().size());
+  cm.for_each([](const int&, const int&){});
+  r = 7;
+  ASSERT_EQ(7, m[105]);
+  // a repeated insert replaces the pair, before and after a merge
+  m.insert(5, 50);
+  ASSERT_EQ(101, cm.size());
+  ASSERT_EQ(101, cm.sorted_keys().size());
+  ASSERT_EQ(101, cm.size());
+  m.flush();
+  ASSERT_EQ(101, m.size());
+  ASSERT_EQ(50, m[5]);
+}
+
+
+TEST(BasicBinSearchMapTests, RangeViewCheck)
+{
+  BinSearchMap<int,int> m;
+  for (int i = 10; i >= 1; --i)
+    m.insert(i * 10, i);
+  SeqView<int> k = m.find_range(25, 55);
+  ASSERT_EQ(3, k.size());
+  for (int i = 0; i < 3; ++i)
+    ASSERT_EQ(30 + i * 10, k[i]);
+  SeqView<int> v = m.value_range(25, 55);
+  ASSERT_EQ(3, v.size());
+  ASSERT_EQ(3, v[0]);
+  ASSERT_EQ(0, m.find_range(55, 25).size());
+  ASSERT_EQ(0, m.find_range(101, 200).size());
+  SeqView<int> all = m.sorted_view();
+  ASSERT_EQ(10, all.size());
+  int total = 0;
+  for (int key : all)
+    total += key;
+  ASSERT_EQ(550, total);
+  // views point into the map's own storage
+  ASSERT_EQ(all.data() + 2, k.data());
+  EXPECT_THROW(k[3], std::out_of_range);
+}
+
+
+//----------------------------------------------------------------------
+// Search policy Tests
+//----------------------------------------------------------------------
+
+// compares a policy's lower_bound with std::lower_bound on the keys
+template<typename Search>
+void check_search_policy(const ArraySeq<long,0>& keys)
+{
+  Search search;
+  search.rebuild(keys);
+  long lo = keys.empty() ? 0 : keys[0] - 3;
+  long hi = keys.empty() ? 3 : keys[keys.size() - 1] + 3;
+  long step = (hi - lo) / 2000 + 1;
+  for (long k = lo; k <= hi; k += step) {
+    int expected = std::lower_bound(keys.begin(), keys.end(), k) - keys.begin();
+    ASSERT_EQ(expected, search.lower_bound(keys, k));
+  }
+  for (int i = 0; i < keys.size(); ++i)
+    ASSERT_EQ(i, search.lower_bound(keys, keys[i]));
+}
+
+template<typename Search>
+void check_search_policy_data()
+{
+  ArraySeq<long,0> uniform, skewed, huge, tiny;
+  for (long i = 0; i < 3000; ++i) {
+    uniform.insert(10 * i + (i * 7) % 5, i);
+    skewed.insert(i < 2900 ? i : i * i * i, i);
+  }
+  // above 2^53 nearby keys round to the same double
+  for (long i = 0; i < 100; ++i)
+    huge.insert((1L << 60) + i, i);
+  tiny.insert(5, 0);
+  check_search_policy<Search>(uniform);
+  check_search_policy<Search>(skewed);
+  check_search_policy<Search>(huge);
+  check_search_policy<Search>(tiny);
+  check_search_policy<Search>(ArraySeq<long,0>());
+}
+
+TEST(SearchPolicyTests, BinaryCheck)
+{
+  check_search_policy_data<BinarySearch>();
+}
+
+TEST(SearchPolicyTests, InterpolationCheck)
+{
+  check_search_policy_data<InterpolationSearch>();
+}
+
+TEST(SearchPolicyTests, InterpolationSequentialCheck)
+{
+  check_search_policy_data<InterpolationSequentialSearch>();
+}
+
+TEST(SearchPolicyTests, ExponentialCheck)
+{
+  check_search_policy_data<ExponentialSearch>();
+}
+
+TEST(SearchPolicyTests, MapPolicyCheck)
+{
+  BinSearchMap<int,int,FlatSeq,InterpolationSearch> m1;
+  check_against_std_map(m1, 5000);
+  BinSearchMap<int,int,FlatSeq,InterpolationSequentialSearch> m2;
+  check_against_std_map(m2, 5000);
+  BinSearchMap<int,int,TieredSeq,ExponentialSearch> m3;
+  check_against_std_map(m3, 5000);
+}
+
+TEST(SearchPolicyTests, ExponentialSharedMapCheck)
+{
+  // const lookups from several threads (each gallops from its own
+  // hint, so they don't race on the map)
+  BinSearchMap<int,int,FlatSeq,ExponentialSearch> m;
+  for (int i = 0; i < 5000; ++i)
+    m.insert(2 * i, i);
+  m.flush();
+  const BinSearchMap<int,int,FlatSeq,ExponentialSearch>& cm = m;
+  int found[4] = {0, 0, 0, 0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+    readers.emplace_back([&cm, &found, t]{
+      for (int k = t; k < 10000; k += 3)
+        found[t] += cm.contains(k) ? 1 : 0;
+    });
+  for (std::thread& reader : readers)
+    reader.join();
+  for (int t = 0; t < 4; ++t) {
+    int expected = 0;
+    for (int k = t; k < 10000; k += 3)
+      expected += k % 2 == 0 ? 1 : 0;
+    ASSERT_EQ(expected, found[t]);
+  }
+}
+
+
+TEST(SearchPolicyTests, LearnedCheck)
+{
+  check_search_policy_data<LearnedSearch<>>();
+  check_search_policy_data<LearnedSearch<1>>();
+  // keys a double can't hold exactly
+  ArraySeq<long,0> big;
+  for (long i = 0; i < 500; ++i)
+    big.insert((1L << 60) + i * (i % 3), i);
+  std::sort(big.begin(), big.end());
+  ArraySeq<long,0> unique;
+  for (long k : big)
+    if (unique.empty() || unique[unique.size() - 1] != k)
+      unique.insert(k, unique.size());
+  check_search_policy<LearnedSearch<2>>(unique);
+}
+
+TEST(SearchPolicyTests, LearnedMapCheck)
+{
+  BinSearchMap<int,int,FlatSeq,LearnedSearch<>> m1;
+  check_against_std_map(m1, 5000);
+  BinSearchMap<long,long,FlatSeq,LearnedSearch<8>> m2;
+  for (long i = 0; i < 100000; ++i)
+    m2.insert(3 * i, i);
+  ASSERT_EQ(100000, m2.size());
+  ASSERT_TRUE(m2.contains(299997));
+  ASSERT_FALSE(m2.contains(299998));
+  ASSERT_EQ(33333, m2[99999]);
+  ASSERT_EQ(4, m2.find_keys(10, 21).size());
+  // evenly spaced keys fit one segment
+  ASSERT_EQ(1, m2.search_policy().segment_count());
+  ASSERT_TRUE(m2.search_policy().index_bytes() < 100);
+}
+
+
+//----------------------------------------------------------------------
+// Adaptive Map Tests
+//----------------------------------------------------------------------
+
+TEST(AdaptiveMapTests, RandomOpsCheck)
+{
+  HashMap<int,int> m1;
+  check_against_std_map(m1, 5000);
+  AdaptiveMap<int,int> m2;
+  check_against_std_map(m2, 5000);
+  AdaptiveMap<int,int,HashMap,16,4> m3;
+  check_against_std_map(m3, 5000);
+  AdaptiveMap<int,int,BinSearchMap,16,4> m4;
+  check_against_std_map(m4, 5000);
+}
+
+TEST(AdaptiveMapTests, ConversionCheck)
+{
+  AdaptiveMap<int,std::string,HashMap,16,4> m;
+  for (int i = 0; i < 16; ++i)
+    m.insert(i, std::to_string(i));
+  ASSERT_FALSE(m.promoted());
+  m.insert(16, "16");
+  ASSERT_TRUE(m.promoted());
+  ASSERT_EQ(17, m.size());
+  for (int i = 0; i <= 16; ++i)
+    ASSERT_EQ(std::to_string(i), m[i]);
+  // stays promoted until fewer than 4 pairs are left
+  for (int i = 16; i >= 4; --i)
+    m.erase(i);
+  ASSERT_TRUE(m.promoted());
+  m.erase(3);
+  ASSERT_FALSE(m.promoted());
+  ASSERT_EQ(3, m.size());
+  ASSERT_EQ("2", m[2]);
+  ASSERT_FALSE(m.contains(3));
+  // copies and moves keep the representation
+  for (int i = 3; i < 40; ++i)
+    m.insert(i, std::to_string(i));
+  AdaptiveMap<int,std::string,HashMap,16,4> c = m;
+  ASSERT_TRUE(c.promoted());
+  ASSERT_EQ(40, c.size());
+  c.erase(39);
+  ASSERT_EQ(40, m.size());
+  AdaptiveMap<int,std::string,HashMap,16,4> d = std::move(c);
+  ASSERT_EQ(39, d.size());
+  ASSERT_EQ("38", d[38]);
+  ASSERT_EQ(5, d.find_keys(10, 14).size());
+}
+
+
+//----------------------------------------------------------------------
+// Unordered Erase Tests
+//----------------------------------------------------------------------
+
+TEST(ArraySeqEraseTests, EraseUnorderedCheck)
+{
+  ArraySeq<std::string> s;
+  for (int i = 0; i < 5; ++i)
+    s.insert(std::to_string(i), i);
+  s.erase_unordered(1);
+  ASSERT_EQ(4, s.size());
+  ASSERT_EQ("4", s[1]);
+  s.erase_unordered(3);
+  ASSERT_EQ(3, s.size());
+  ASSERT_EQ("0", s[0]);
+  ASSERT_EQ("2", s[2]);
+  EXPECT_THROW(s.erase_unordered(3), std::out_of_range);
+  EXPECT_THROW(s.erase_unordered(-1), std::out_of_range);
+}
+
+TEST(ArraySeqEraseTests, EraseIfCheck)
+{
+  ArraySeq<int,0> s;
+  for (int i = 0; i < 100; ++i)
+    s.insert(i, i);
+  ASSERT_EQ(50, s.erase_if([](int x) { return x % 2 == 1; }));
+  ASSERT_EQ(50, s.size());
+  for (int i = 0; i < 50; ++i)
+    ASSERT_EQ(2 * i, s[i]);
+  ASSERT_EQ(0, s.erase_if([](int x) { return x < 0; }));
+  ASSERT_EQ(50, s.erase_if([](int) { return true; }));
+  ASSERT_TRUE(s.empty());
+}
+
+TEST(ArraySeqEraseTests, ArrayMapChurnCheck)
+{
+  ArrayMap<int,int> m;
+  check_against_std_map(m, 5000);
+}
+
+
+//----------------------------------------------------------------------
+// Sorted Key Cache Tests
+//----------------------------------------------------------------------
+
+template<typename M>
+void check_sorted_key_cache()
+{
+  M m;
+  ASSERT_EQ(0, m.sorted_view().size());
+  for (int i = 0; i < 200; ++i)
+    m.insert((i * 37) % 200, i);
+  ArraySeq<int> k = m.sorted_keys();
+  ASSERT_EQ(200, k.size());
+  SeqView<int> v = m.sorted_view();
+  for (int i = 0; i < 200; ++i) {
+    ASSERT_EQ(i, k[i]);
+    ASSERT_EQ(i, v[i]);
+  }
+  ASSERT_EQ(11, m.find_keys(50, 60).size());
+  ASSERT_EQ(0, m.find_keys(60, 50).size());
+  // writes invalidate the cached keys
+  m.erase(55);
+  m.insert(500, 0);
+  k = m.find_keys(50, 60);
+  ASSERT_EQ(10, k.size());
+  ASSERT_EQ(56, k[5]);
+  v = m.sorted_view();
+  ASSERT_EQ(200, v.size());
+  ASSERT_EQ(500, v[199]);
+  // copies get their own cache
+  M c = m;
+  c.erase(500);
+  ASSERT_EQ(199, c.sorted_keys()[198]);
+  ASSERT_EQ(500, m.sorted_keys()[199]);
+}
+
+TEST(SortedKeyCacheTests, ArrayMapCheck)
+{
+  check_sorted_key_cache<ArrayMap<int,int>>();
+}
+
+TEST(SortedKeyCacheTests, HashMapCheck)
+{
+  check_sorted_key_cache<HashMap<int,int>>();
+}
+
+
+//----------------------------------------------------------------------
+// Blocked Sorted Map Tests
+//----------------------------------------------------------------------
+
+TEST(BlockedSortedMapTests, RandomOpsCheck)
+{
+  BlockedSortedMap<int,int> m;
+  check_against_std_map(m, 5000);
+}
+
+TEST(BlockedSortedMapTests, SplitAndMergeCheck)
+{
+  BlockedSortedMap<int,std::string> m;
+  ASSERT_EQ(0, m.find_keys(0, 10).size());
+  // descending inserts keep changing the first block's fence
+  for (int i = 10000; i > 0; --i)
+    m.insert(2 * i, std::to_string(i));
+  ASSERT_EQ(10000, m.size());
+  ASSERT_TRUE(m.block_count() > 10000 / 512);
+  ArraySeq<int> k = m.sorted_keys();
+  for (int i = 0; i < k.size(); ++i)
+    ASSERT_EQ(2 * (i + 1), k[i]);
+  ASSERT_EQ("500", m[1000]);
+  ASSERT_FALSE(m.contains(1001));
+  EXPECT_THROW(m[1001], std::out_of_range);
+  k = m.find_keys(999, 2001);
+  ASSERT_EQ(501, k.size());
+  ASSERT_EQ(1000, k[0]);
+  // copies are independent
+  BlockedSortedMap<int,std::string> c = m;
+  for (int i = 1; i <= 10000; i += 2)
+    m.erase(2 * i);
+  ASSERT_EQ(5000, m.size());
+  ASSERT_EQ(10000, c.size());
+  for (int i = 2; i <= 10000; i += 2)
+    m.erase(2 * i);
+  ASSERT_TRUE(m.empty());
+  ASSERT_EQ(0, m.block_count());
+  m.insert(5, "5");
+  ASSERT_EQ("5", m[5]);
+  BlockedSortedMap<int,std::string> d = std::move(c);
+  ASSERT_EQ("10000", d[20000]);
+  ASSERT_EQ(0, c.size());
+}
+
+
+//----------------------------------------------------------------------
+// Find Tests
+//----------------------------------------------------------------------
+
+template<typename M>
+void check_find()
+{
+  M m;
+  ASSERT_EQ(nullptr, m.find(1));
+  for (int i = 0; i < 300; ++i)
+    m.insert(3 * i, i);
+  for (int i = 0; i < 900; ++i) {
+    int* value = m.find(i);
+    if (i % 3 == 0) {
+      ASSERT_NE(nullptr, value);
+      ASSERT_EQ(i / 3, *value);
+    }
+    else
+      ASSERT_EQ(nullptr, value);
+  }
+  ASSERT_EQ(nullptr, m.find(-1));
+  ASSERT_EQ(nullptr, m.find(900));
+  *m.find(30) = -5;
+  const M& c = m;
+  ASSERT_EQ(-5, *c.find(30));
+  ASSERT_EQ(nullptr, c.find(31));
+  m.erase(30);
+  ASSERT_EQ(nullptr, m.find(30));
+  // through the Map interface
+  Map<int,int>& base = m;
+  ASSERT_EQ(1, *base.find(3));
+  ASSERT_EQ(nullptr, base.find(4));
+}
+
+TEST(FindTests, AllMapsCheck)
+{
+  check_find<ArrayMap<int,int>>();
+  check_find<BinSearchMap<int,int>>();
+  check_find<HashMap<int,int>>();
+  check_find<BSTMap<int,int>>();
+  check_find<AdaptiveMap<int,int>>();
+  check_find<BlockedSortedMap<int,int>>();
+  check_find<PersistentBSTMap<int,int>>();
+}
+
+
+//----------------------------------------------------------------------
+// Upsert Tests
+//----------------------------------------------------------------------
+
+template<typename M>
+void check_upserts()
+{
+  M m;
+  // counter aggregation: increment or insert 1
+  std::map<int,int> expected;
+  std::mt19937 gen(11);
+  for (int r = 0; r < 3000; ++r) {
+    int key = gen() % 700;
+    std::pair<int*,bool> result = m.try_insert(key, 1);
+    if (!result.second)
+      ++*result.first;
+    ++expected[key];
+    ASSERT_EQ(expected[key], *result.first);
+  }
+  ASSERT_EQ((int)expected.size(), m.size());
+  for (auto& kv : expected)
+    ASSERT_EQ(kv.second, m[kv.first]);
+  // insert_or_assign overwrites
+  ASSERT_FALSE(m.insert_or_assign(expected.begin()->first, -1));
+  ASSERT_EQ(-1, m[expected.begin()->first]);
+  ASSERT_TRUE(m.insert_or_assign(1000, 5));
+  ASSERT_EQ(5, m[1000]);
+  ASSERT_EQ((int)expected.size() + 1, m.size());
+  // emplace leaves a present key alone
+  std::pair<int*,bool> e = m.emplace(1000, 9);
+  ASSERT_FALSE(e.second);
+  ASSERT_EQ(5, *e.first);
+  e = m.emplace(1001, 9);
+  ASSERT_TRUE(e.second);
+  ASSERT_EQ(9, m[1001]);
+}
+
+TEST(UpsertTests, AllMapsCheck)
+{
+  check_upserts<ArrayMap<int,int>>();
+  check_upserts<BinSearchMap<int,int>>();
+  check_upserts<HashMap<int,int>>();
+  check_upserts<BSTMap<int,int>>();
+  check_upserts<AdaptiveMap<int,int>>();
+  check_upserts<BlockedSortedMap<int,int>>();
+  check_upserts<PersistentBSTMap<int,int>>();
+}
+
+TEST(UpsertTests, EmplaceConstructsValueCheck)
+{
+  HashMap<int,std::string> m1;
+  ASSERT_EQ("xxx", *m1.emplace(1, 3, 'x').first);
+  BSTMap<int,std::string> m2;
+  ASSERT_EQ("yy", *m2.emplace(1, 2, 'y').first);
+  BinSearchMap<int,std::string> m3;
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(std::string(i % 5, 'z'), *m3.emplace(i, i % 5, 'z').first);
+  ASSERT_EQ("zz", m3[97]);
+  BlockedSortedMap<int,std::string> m4;
+  for (int i = 0; i < 2000; ++i)
+    ASSERT_EQ(std::to_string(i), *m4.emplace(i, std::to_string(i)).first);
+  AdaptiveMap<int,std::string,HashMap,4,1> m5;
+  for (int i = 0; i < 10; ++i)
+    ASSERT_EQ("w", *m5.emplace(i, 1, 'w').first);
+  ASSERT_TRUE(m5.promoted());
+}
+
+
+//----------------------------------------------------------------------
+// Move and Forwarding Insert Tests
+//----------------------------------------------------------------------
+
+// value type that counts how often it is copied
+struct CopyCounted {
+  static int copies;
+  int id = 0;
+  CopyCounted() = default;
+  explicit CopyCounted(int id) : id(id) {}
+  CopyCounted(const CopyCounted& rhs) : id(rhs.id) {++copies;}
+  CopyCounted(CopyCounted&& rhs) = default;
+  CopyCounted& operator=(const CopyCounted& rhs) {id = rhs.id; ++copies; return *this;}
+  CopyCounted& operator=(CopyCounted&& rhs) = default;
+  // (needed by ArraySeq's sort and contains)
+  bool operator==(const CopyCounted& rhs) const {return id == rhs.id;}
+  bool operator<(const CopyCounted& rhs) const {return id < rhs.id;}
+};
+
+int CopyCounted::copies = 0;
+
+template<typename M>
+void check_move_inserts()
+{
+  M m;
+  CopyCounted::copies = 0;
+  // enough pairs to resize, flush, split or promote the map
+  for (int i = 0; i < 3000; i += 2)
+    m.insert(std::string(40, 'a') + std::to_string(i), CopyCounted(i));
+  for (int i = 1; i < 3000; i += 2)
+    ASSERT_TRUE(m.try_insert(std::string(40, 'a') + std::to_string(i), CopyCounted(i)).second);
+  ASSERT_TRUE(m.insert_or_assign(std::string("b"), CopyCounted(-1)));
+  ASSERT_TRUE(m.emplace(std::string("c"), 7).second);
+  ASSERT_EQ(0, CopyCounted::copies);
+  ASSERT_EQ(3002, m.size());
+  for (int i = 0; i < 3000; ++i)
+    ASSERT_EQ(i, m[std::string(40, 'a') + std::to_string(i)].id);
+  ASSERT_EQ(-1, m["b"].id);
+  ASSERT_EQ(7, m["c"].id);
+  // the key and value are only moved from if the pair is inserted
+  std::string key(40, 'c');
+  CopyCounted value(1);
+  ASSERT_TRUE(m.try_insert(std::move(key), std::move(value)).second);
+  ASSERT_TRUE(key.empty());
+  key = std::string(40, 'c');
+  ASSERT_FALSE(m.try_insert(std::move(key), CopyCounted(2)).second);
+  ASSERT_EQ(std::string(40, 'c'), key);
+  ASSERT_EQ(1, m[key].id);
+  ASSERT_FALSE(m.insert_or_assign(std::move(key), CopyCounted(3)));
+  ASSERT_EQ(std::string(40, 'c'), key);
+  ASSERT_EQ(3, m[key].id);
+  ASSERT_EQ(0, CopyCounted::copies);
+}
+
+TEST(MoveInsertTests, AllMapsCheck)
+{
+  check_move_inserts<ArrayMap<std::string,CopyCounted>>();
+  check_move_inserts<BinSearchMap<std::string,CopyCounted>>();
+  check_move_inserts<HashMap<std::string,CopyCounted>>();
+  check_move_inserts<BSTMap<std::string,CopyCounted>>();
+  check_move_inserts<AdaptiveMap<std::string,CopyCounted>>();
+  check_move_inserts<BlockedSortedMap<std::string,CopyCounted>>();
+  check_move_inserts<PersistentBSTMap<std::string,CopyCounted>>();
+}
+
+TEST(MoveInsertTests, SequencesMoveCheck)
+{
+  FlatSeq<std::string> s1;
+  TieredSeq<std::string> s2;
+  for (int i = 0; i < 200; ++i) {
+    std::string elem(40, 'a' + i % 26);
+    s1.insert(std::move(elem), i / 2);
+    ASSERT_TRUE(elem.empty());
+    elem = std::string(40, 'a' + i % 26);
+    s2.insert(std::move(elem), i / 2);
+    ASSERT_TRUE(elem.empty());
+  }
+  ASSERT_EQ(200, s1.size());
+  ASSERT_EQ(200, s2.size());
+  for (int i = 0; i < 200; ++i)
+    ASSERT_EQ(s1[i], s2[i]);
+  // through the Sequence interface
+  Sequence<std::string>& seq = s1;
+  std::string elem(40, 'z');
+  seq.insert(std::move(elem), 0);
+  ASSERT_TRUE(elem.empty());
+  ASSERT_EQ(std::string(40, 'z'), s1[0]);
+}
+
+
+//----------------------------------------------------------------------
+// Batch Operation Tests
+//----------------------------------------------------------------------
+
+template<typename M>
+void check_batches()
+{
+  M concrete;
+  Map<int,int>& m = concrete;
+  std::map<int,int> expected;
+  std::mt19937 gen(5);
+  for (int round = 0; round < 6; ++round) {
+    // a batch of new keys, in random order
+    ArraySeq<int> keys;
+    ArraySeq<int> values;
+    int size = 1 + gen() % 400;
+    while (keys.size() < size) {
+      int key = gen() % 5000;
+      if (expected.count(key) || keys.contains(key))
+        continue;
+      keys.insert(key, keys.size());
+      values.insert(key * 2, values.size());
+      expected[key] = key * 2;
+    }
+    m.insert_batch(keys, values);
+    ASSERT_EQ((int)expected.size(), m.size());
+    // erase about a third of the keys
+    ArraySeq<int> gone;
+    for (auto& kv : expected)
+      if (gen() % 3 == 0)
+        gone.insert(kv.first, gone.size());
+    for (int i = 0; i < gone.size(); ++i)
+      expected.erase(gone[i]);
+    m.erase_batch(gone);
+    ASSERT_EQ((int)expected.size(), m.size());
+    // look up present and missing keys
+    ArraySeq<int> queries;
+    for (int i = 0; i < 300; ++i)
+      queries.insert(gen() % 5000, i);
+    ArraySeq<bool> found = m.contains_batch(queries);
+    ASSERT_EQ(queries.size(), found.size());
+    for (int i = 0; i < queries.size(); ++i)
+      ASSERT_EQ(expected.count(queries[i]) == 1, found[i]);
+  }
+  ArraySeq<int> keys = m.sorted_keys();
+  ASSERT_EQ((int)expected.size(), keys.size());
+  int i = 0;
+  for (auto& kv : expected) {
+    ASSERT_EQ(kv.first, keys[i++]);
+    ASSERT_EQ(kv.second, m[kv.first]);
+  }
+  // a missing key leaves the map as it was
+  ArraySeq<int> bad;
+  bad.insert(expected.begin()->first, 0);
+  bad.insert(-1, 1);
+  ASSERT_THROW(m.erase_batch(bad), std::out_of_range);
+  ASSERT_EQ((int)expected.size(), m.size());
+  ASSERT_TRUE(m.contains(expected.begin()->first));
+  // keys and values must match up
+  ArraySeq<int> values;
+  ASSERT_THROW(m.insert_batch(bad, values), std::out_of_range);
+  ASSERT_EQ((int)expected.size(), m.size());
+}
+
+TEST(BatchTests, AllMapsCheck)
+{
+  check_batches<ArrayMap<int,int>>();
+  check_batches<BinSearchMap<int,int>>();
+  check_batches<BinSearchMap<int,int,TieredSeq>>();
+  check_batches<HashMap<int,int>>();
+  check_batches<BSTMap<int,int>>();
+  check_batches<AdaptiveMap<int,int>>();
+  check_batches<BlockedSortedMap<int,int>>();
+  check_batches<PersistentBSTMap<int,int>>();
+}
+
+TEST(BatchTests, BSTMapBuildsBalancedSubtreesCheck)
+{
+  BSTMap<int,int> m;
+  ArraySeq<int> keys;
+  ArraySeq<int> values;
+  // sorted input would give a chain of height 1023 one key at a time
+  for (int i = 0; i < 1023; ++i) {
+    keys.insert(i, i);
+    values.insert(i, i);
+  }
+  m.insert_batch(keys, values);
+  ASSERT_EQ(1023, m.size());
+  ASSERT_EQ(10, m.height());
+  for (int i = 0; i < 1023; ++i)
+    ASSERT_EQ(i, m[i]);
+}
+
+TEST(BatchTests, HashMapPresizesCheck)
+{
+  HashMap<int,int> m;
+  ArraySeq<int> keys;
+  ArraySeq<int> values;
+  for (int i = 0; i < 1000; ++i) {
+    keys.insert(i, i);
+    values.insert(-i, i);
+  }
+  m.insert_batch(keys, values);
+  ASSERT_EQ(1000, m.size());
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_EQ(-i, m[i]);
+  ASSERT_LT(m.avg_chain_length(), 2.0);
+}
+
+
+//----------------------------------------------------------------------
+// Visitor Tests
+//----------------------------------------------------------------------
+
+template<typename M>
+void check_for_each(bool sorted)
+{
+  M m;
+  std::map<int,int> expected;
+  std::mt19937 gen(17);
+  for (int i = 0; i < 2500; ++i) {
+    int key = gen() % 10000;
+    if (m.try_insert(key, key + 1).second)
+      expected[key] = key + 1;
+  }
+  // every pair once, in ascending order for the sorted maps
+  std::vector<std::pair<int,int>> seen;
+  m.for_each([&](const int& key, int& value){seen.push_back({key, value});});
+  ASSERT_EQ(expected.size(), seen.size());
+  if (!sorted)
+    std::sort(seen.begin(), seen.end());
+  std::vector<std::pair<int,int>> pairs(expected.begin(), expected.end());
+  ASSERT_EQ(pairs, seen);
+  // values can be updated in place
+  m.for_each([](const int& key, int& value){value = -key;});
+  for (auto& kv : expected)
+    ASSERT_EQ(-kv.first, m[kv.first]);
+  // ranges, through a const map
+  const M& cm = m;
+  for (int r = 0; r < 50; ++r) {
+    int k1 = gen() % 11000 - 500;
+    int k2 = k1 + gen() % 2000;
+    std::vector<int> keys;
+    cm.for_each_in_range(k1, k2, [&](const int& key, const int& value){
+      ASSERT_EQ(-key, value);
+      keys.push_back(key);
+    });
+    if (!sorted)
+      std::sort(keys.begin(), keys.end());
+    std::vector<int> in_range;
+    for (auto it = expected.lower_bound(k1); it != expected.upper_bound(k2); ++it)
+      in_range.push_back(it->first);
+    ASSERT_EQ(in_range, keys);
+  }
+  int n = 0;
+  cm.for_each([&](const int&, const int&){++n;});
+  ASSERT_EQ((int)expected.size(), n);
+  // a const map only hands out const values (for every pair, not
+  // just the first or the root)
+  int writable = 0;
+  auto count_writable = [&](const int&, auto& value){
+    if (!std::is_const<std::remove_reference_t<decltype(value)>>::value)
+      ++writable;
+  };
+  cm.for_each(count_writable);
+  cm.for_each_in_range(-500, 11000, count_writable);
+  ASSERT_EQ(0, writable);
+  // an empty map visits nothing
+  M empty;
+  empty.for_each([&](const int&, int&){++n;});
+  empty.for_each_in_range(0, 100, [&](const int&, int&){++n;});
+  ASSERT_EQ((int)expected.size(), n);
+}
+
+TEST(VisitorTests, AllMapsCheck)
+{
+  check_for_each<ArrayMap<int,int>>(false);
+  check_for_each<BinSearchMap<int,int>>(true);
+  check_for_each<HashMap<int,int>>(false);
+  check_for_each<BSTMap<int,int>>(true);
+  check_for_each<AdaptiveMap<int,int>>(false);
+  check_for_each<BlockedSortedMap<int,int>>(true);
+  check_for_each<PersistentBSTMap<int,int>>(true);
+}
+
+TEST(VisitorTests, BinSearchMapVisitsBufferedPairsCheck)
+{
+  BinSearchMap<int,int> m;
+  for (int i = 0; i < 10; ++i)
+    m.insert(i, i);
+  m.erase(3);
+  int sum = 0;
+  m.for_each([&](const int& key, int&){sum += key;});
+  ASSERT_EQ(42, sum);
+}
+
+
+//----------------------------------------------------------------------
+// Persistent BST Map Tests
+//----------------------------------------------------------------------
+
+TEST(PersistentBSTMapTests, MatchesStdMapCheck)
+{
+  PersistentBSTMap<int,int> m;
+  check_against_std_map(m, 20000);
+}
+
+TEST(PersistentBSTMapTests, StaysBalancedCheck)
+{
+  PersistentBSTMap<int,int> m;
+  for (int i = 0; i < 4095; ++i)
+    m.insert(i, i);
+  // AVL height is under 1.45 lg n
+  ASSERT_LE(m.height(), 17);
+  for (int i = 0; i < 4095; i += 2)
+    m.erase(i);
+  ASSERT_LE(m.height(), 16);
+  ASSERT_EQ(2047, m.size());
+  for (int i = 0; i < 4095; ++i)
+    ASSERT_EQ(i % 2 == 1, m.contains(i));
+}
+
+TEST(PersistentBSTMapTests, SnapshotsAreIsolatedCheck)
+{
+  PersistentBSTMap<int,int> m;
+  std::map<int,int> expected;
+  std::mt19937 gen(3);
+  std::vector<PersistentBSTMap<int,int>> versions;
+  std::vector<std::map<int,int>> expected_versions;
+  for (int round = 0; round < 20; ++round) {
+    versions.push_back(m.snapshot());
+    expected_versions.push_back(expected);
+    for (int r = 0; r < 200; ++r) {
+      int key = gen() % 300;
+      if (expected.count(key) == 0) {
+        m.insert(key, r);
+        expected[key] = r;
+      }
+      else if (gen() % 2 == 0) {
+        m.erase(key);
+        expected.erase(key);
+      }
+      else {
+        m[key] += 1;
+        ++expected[key];
+      }
+    }
+  }
+  // every snapshot still holds exactly the pairs it was taken with
+  for (size_t v = 0; v < versions.size(); ++v) {
+    const PersistentBSTMap<int,int>& snap = versions[v];
+    ASSERT_EQ((int)expected_versions[v].size(), snap.size());
+    std::vector<std::pair<int,int>> seen;
+    snap.for_each([&](const int& key, const int& value){seen.push_back({key, value});});
+    std::vector<std::pair<int,int>> pairs(expected_versions[v].begin(),
+                                          expected_versions[v].end());
+    ASSERT_EQ(pairs, seen);
+  }
+  // and writes to a snapshot don't show in the map
+  PersistentBSTMap<int,int> snap = m.snapshot();
+  snap.for_each([](const int&, int& value){value = 0;});
+  snap.insert(-1, -1);
+  for (auto& kv : expected)
+    ASSERT_EQ(kv.second, m[kv.first]);
+  ASSERT_FALSE(m.contains(-1));
+  ASSERT_EQ((int)expected.size(), m.size());
+}
+
+TEST(PersistentBSTMapTests, CopiesShareNodesCheck)
+{
+  PersistentBSTMap<int,std::string> m;
+  for (int i = 0; i < 1000; ++i)
+    m.insert(i, std::string(100, 'a'));
+  PersistentBSTMap<int,std::string> copy(m);
+  const PersistentBSTMap<int,std::string>& cm = m;
+  const PersistentBSTMap<int,std::string>& ccopy = copy;
+  // nothing is copied until one of them writes
+  ASSERT_EQ(&cm[500], &ccopy[500]);
+  copy[500] = "b";
+  ASSERT_NE(&cm[500], &ccopy[500]);
+  ASSERT_EQ(std::string(100, 'a'), cm[500]);
+  // pairs off the written path are still shared
+  ASSERT_EQ(&cm[0], &ccopy[0]);
+  ASSERT_EQ(&cm[999], &ccopy[999]);
+  // moving leaves the source empty
+  PersistentBSTMap<int,std::string> moved(std::move(copy));
+  ASSERT_EQ(0, copy.size());
+  ASSERT_EQ(1000, moved.size());
+  ASSERT_EQ("b", moved[500]);
+}
+
+
+//----------------------------------------------------------------------
+// Snapshot Tests
+//----------------------------------------------------------------------
+
+// Returns a path for a scratch snapshot file
+std::string snapshot_path(const std::string& name)
+{
+  return testing::TempDir() + "hw7_" + name + ".snap";
+}
+
+template<typename M>
+void check_snapshot_round_trip(const std::string& name)
+{
+  M m;
+  std::map<int,double> expected;
+  std::mt19937 gen(21);
+  for (int i = 0; i < 3000; ++i) {
+    int key = gen() % 100000;
+    if (m.try_insert(key, key * 0.5).second)
+      expected[key] = key * 0.5;
+  }
+  std::string path = snapshot_path(name);
+  save_snapshot(m, path);
+  // loading replaces whatever the map held
+  M loaded;
+  loaded.insert(-1, -1.0);
+  load_snapshot(path, loaded);
+  ASSERT_EQ((int)expected.size(), loaded.size());
+  ArraySeq<int> keys = loaded.sorted_keys();
+  int i = 0;
+  for (auto& kv : expected) {
+    ASSERT_EQ(kv.first, keys[i++]);
+    ASSERT_EQ(kv.second, loaded[kv.first]);
+  }
+  // every map writes the same (sorted) file, so any map can serve it
+  SnapshotMap<int,double> mapped(path);
+  ASSERT_EQ((int)expected.size(), mapped.size());
+  for (auto& kv : expected)
+    ASSERT_EQ(kv.second, mapped[kv.first]);
+  ASSERT_FALSE(mapped.contains(-1));
+  ASSERT_EQ(nullptr, mapped.find(100000));
+  ASSERT_THROW(mapped[-1], std::out_of_range);
+  ASSERT_TRUE(std::is_sorted(mapped.keys().begin(), mapped.keys().end()));
+  std::remove(path.c_str());
+}
+
+TEST(SnapshotTests, MapRoundTripCheck)
+{
+  check_snapshot_round_trip<BinSearchMap<int,double>>("binsearch");
+  check_snapshot_round_trip<BinSearchMap<int,double,TieredSeq>>("tiered");
+  check_snapshot_round_trip<HashMap<int,double>>("hash");
+  check_snapshot_round_trip<BSTMap<int,double>>("bst");
+  check_snapshot_round_trip<ArrayMap<int,double>>("array");
+  check_snapshot_round_trip<BlockedSortedMap<int,double>>("blocked");
+}
+
+TEST(SnapshotTests, LoadedBSTMapIsBalancedCheck)
+{
+  BinSearchMap<int,double> m;
+  for (int i = 0; i < 1023; ++i)
+    m.insert(i, i);
+  std::string path = snapshot_path("balanced");
+  save_snapshot(m, path);
+  BSTMap<int,double> bst;
+  load_snapshot(path, bst);
+  ASSERT_EQ(1023, bst.size());
+  ASSERT_EQ(10, bst.height());
+  std::remove(path.c_str());
+}
+
+TEST(SnapshotTests, SequenceRoundTripCheck)
+{
+  ArraySeq<long> seq;
+  for (long i = 0; i < 5000; ++i)
+    seq.insert(i * i, seq.size());
+  std::string path = snapshot_path("seq");
+  save_snapshot(seq, path);
+  FlatSeq<long> loaded;
+  loaded.insert(7, 0);
+  load_snapshot(path, loaded);
+  ASSERT_EQ(5000, loaded.size());
+  for (int i = 0; i < 5000; ++i)
+    ASSERT_EQ((long)i * i, loaded[i]);
+  // an empty sequence round trips too
+  save_snapshot(ArraySeq<long>(), path);
+  load_snapshot(path, loaded);
+  ASSERT_EQ(0, loaded.size());
+  std::remove(path.c_str());
+}
+
+TEST(SnapshotTests, SaveOverMappedSnapshotCheck)
+{
+  BinSearchMap<int,double> m;
+  for (int i = 0; i < 1000; ++i)
+    m.insert(i, i * 0.5);
+  std::string path = snapshot_path("replace");
+  save_snapshot(m, path);
+  SnapshotMap<int,double> old(path);
+  // a new (smaller) snapshot replaces the file; the open map keeps
+  // reading the old one
+  BinSearchMap<int,double> small;
+  small.insert(-1, 1.0);
+  save_snapshot(small, path);
+  ASSERT_EQ(1000, old.size());
+  ASSERT_TRUE(old.contains(999));
+  ASSERT_EQ(499.5, old[999]);
+  SnapshotMap<int,double> current(path);
+  ASSERT_EQ(1, current.size());
+  ASSERT_TRUE(current.contains(-1));
+  // the temporary file was renamed, not left behind
+  std::ifstream temp(path + ".tmp");
+  ASSERT_FALSE(temp.good());
+  std::remove(path.c_str());
+}
+
+TEST(SnapshotTests, BadFilesThrowCheck)
+{
+  BinSearchMap<int,double> m;
+  m.insert(1, 1.0);
+  ASSERT_THROW(load_snapshot(snapshot_path("missing"), m), std::runtime_error);
+  ASSERT_THROW(save_snapshot(m, "/nonexistent/dir/file.snap"), std::runtime_error);
+  // wrong element types
+  std::string path = snapshot_path("types");
+  save_snapshot(m, path);
+  HashMap<int,int> wrong;
+  ASSERT_THROW(load_snapshot(path, wrong), std::runtime_error);
+  ArraySeq<int> seq;
+  ASSERT_THROW(load_snapshot(path, seq), std::runtime_error);
+  // corrupted offsets (one that would wrap around, and ones past the
+  // end of the file)
+  m.insert(2, 2.0);
+  save_snapshot(m, path);
+  std::uint64_t offsets[] = {0 - (std::uint64_t) 1024, 1 << 20, 0};
+  for (std::uint64_t offset : offsets) {
+    for (std::size_t field : {offsetof(SnapshotHeader, keys_offset),
+                              offsetof(SnapshotHeader, values_offset)}) {
+      save_snapshot(m, path);
+      std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(field);
+      file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+      file.close();
+      ASSERT_THROW((SnapshotMap<int,double>(path)), std::runtime_error);
+      HashMap<int,double> h;
+      ASSERT_THROW(load_snapshot(path, h), std::runtime_error);
+    }
+  }
+  m.erase(2);
+  // truncated file
+  std::ofstream(path, std::ios::binary) << "HW7SNAP";
+  ASSERT_THROW((SnapshotMap<int,double>(path)), std::runtime_error);
+  // a failed load leaves the map alone
+  ASSERT_THROW(load_snapshot(path, m), std::runtime_error);
+  ASSERT_EQ(1, m.size());
+  std::remove(path.c_str());
+}
+
+
+//----------------------------------------------------------------------
+// Memory Resource Tests
+//----------------------------------------------------------------------
+
+// memory resource that counts what it hands out (and checks that every
+// block is given back with the size and alignment it was allocated with)
+class CountingResource : public std::pmr::memory_resource {
+public:
+  int allocations = 0;
+  long outstanding = 0;
+private:
+  std::map<void*,std::pair<size_t,size_t>> blocks;
+  void* do_allocate(size_t bytes, size_t align) override {
+    void* p = std::pmr::new_delete_resource()->allocate(bytes, align);
+    blocks[p] = {bytes, align};
+    ++allocations;
+    outstanding += bytes;
+    return p;
+  }
+  void do_deallocate(void* p, size_t bytes, size_t align) override {
+    auto block = blocks.find(p);
+    ASSERT_TRUE(block != blocks.end());
+    ASSERT_EQ(block->second, std::make_pair(bytes, align));
+    blocks.erase(block);
+    outstanding -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& rhs) const noexcept override {
+    return this == &rhs;
+  }
+};
+
+// replaces the default resource for the lifetime of the guard (by
+// default with one that makes every allocation throw)
+struct DefaultResourceGuard {
+  std::pmr::memory_resource* old;
+  explicit DefaultResourceGuard(std::pmr::memory_resource* r = std::pmr::null_memory_resource())
+    : old(std::pmr::set_default_resource(r)) {}
+  ~DefaultResourceGuard() {std::pmr::set_default_resource(old);}
+};
+
+template<typename M>
+void check_memory_resource()
+{
+  CountingResource r;
+  {
+    DefaultResourceGuard guard;
+    M m(&r);
+    ASSERT_EQ(&r, m.memory_resource());
+    for (int i = 0; i < 1000; ++i)
+      m.insert((i * 7919) % 1000, i);
+    for (int i = 0; i < 1000; i += 3)
+      m.erase(i);
+    ArraySeq<int> keys = m.sorted_keys();
+    ASSERT_EQ(&r, keys.memory_resource());
+    ASSERT_EQ(666, keys.size());
+    ArraySeq<int> range = m.find_keys(100, 199);
+    ASSERT_EQ(&r, range.memory_resource());
+    ASSERT_EQ(67, range.size());
+    // moves keep the resource and don't copy the pairs (HashMap only
+    // allocates an empty table for the moved-from map)
+    int before = r.allocations;
+    M m2(std::move(m));
+    ASSERT_EQ(&r, m2.memory_resource());
+    ASSERT_EQ(666, m2.size());
+    ASSERT_TRUE(m2.contains(998));
+    ASSERT_FALSE(m2.contains(999));
+    ASSERT_TRUE(r.allocations - before <= 1);
+    ASSERT_TRUE(r.outstanding > 0);
+  }
+  ASSERT_EQ(0, r.outstanding);
+}
+
+TEST(MemoryResourceTests, MapsAllocateFromResourceCheck)
+{
+  check_memory_resource<HashMap<int,int>>();
+  check_memory_resource<BSTMap<int,int>>();
+}
+
+TEST(MemoryResourceTests, ArraySeqAllocatesFromResourceCheck)
+{
+  CountingResource r;
+  {
+    DefaultResourceGuard guard;
+    FlatSeq<int> s(&r);
+    ArraySeq<int> small(&r);
+    for (int i = 0; i < 1000; ++i) {
+      s.insert(i, s.size());
+      small.insert(i, small.size());
+    }
+    ASSERT_TRUE(r.allocations > 0);
+    s.erase_if([](int x) {return x % 2 == 0;});
+    ASSERT_EQ(500, s.size());
+    FlatSeq<int> s2(&r);
+    s2 = s;
+    ASSERT_EQ(&r, s2.memory_resource());
+    ASSERT_EQ(500, s2.size());
+  }
+  ASSERT_EQ(0, r.outstanding);
+  // an arena: nothing is given back until the arena goes away
+  std::pmr::monotonic_buffer_resource arena;
+  FlatSeq<std::string> s(&arena);
+  for (int i = 0; i < 100; ++i)
+    s.insert(std::to_string(i), 0);
+  ASSERT_EQ("0", s[99]);
+}
+
+TEST(MemoryResourceTests, MoveBetweenResourcesCheck)
+{
+  CountingResource r1, r2;
+  {
+    HashMap<int,int> h1(&r1), h2(&r2);
+    BSTMap<int,int> b1(&r1), b2(&r2);
+    FlatSeq<int> s1(&r1), s2(&r2);
+    for (int i = 0; i < 100; ++i) {
+      h2.insert(i, i);
+      b2.insert((i * 37) % 100, i);
+      s2.insert(i, i);
+    }
+    // the pairs can't be stolen, so they are copied into r1
+    h1 = std::move(h2);
+    b1 = std::move(b2);
+    s1 = std::move(s2);
+    ASSERT_EQ(&r1, h1.memory_resource());
+    ASSERT_EQ(&r1, b1.memory_resource());
+    ASSERT_EQ(&r1, s1.memory_resource());
+    ASSERT_EQ(100, h1.size());
+    ASSERT_EQ(100, b1.size());
+    ASSERT_EQ(100, s1.size());
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ(i, h1[i]);
+      ASSERT_EQ(i, b1[(i * 37) % 100]);
+      ASSERT_EQ(i, s1[i]);
+    }
+    // copies allocate from the default resource
+    HashMap<int,int> h3(h1);
+    ASSERT_EQ(std::pmr::get_default_resource(), h3.memory_resource());
+    ASSERT_EQ(100, h3.size());
+  }
+  ASSERT_EQ(0, r1.outstanding);
+  ASSERT_EQ(0, r2.outstanding);
+}
+
+
+//----------------------------------------------------------------------
+// Memory Usage Tests
+//----------------------------------------------------------------------
+
+// checks the breakdown after inserts and erases; if every allocation
+// of the map goes through the default memory resource, the total must
+// also be exactly the object plus what the resource handed out
+template<typename M>
+void check_memory_usage(bool all_pmr)
+{
+  CountingResource r;
+  DefaultResourceGuard guard(&r);
+  M m;
+  ASSERT_EQ(0, m.memory_usage().payload);
+  for (int i = 0; i < 5000; ++i)
+    m.insert((i * 7919) % 5000, i);
+  for (int i = 0; i < 5000; i += 2)
+    m.erase(i);
+  // builds the key caches; the non-const for_each merges
+  // BinSearchMap's write buffer
+  m.sorted_keys();
+  m.for_each([](const int&, int&){});
+  MemoryUsage usage = m.memory_usage();
+  ASSERT_EQ(2500 * 2 * (long) sizeof(int), usage.payload);
+  ASSERT_TRUE(usage.overhead >= 0);
+  ASSERT_TRUE(usage.slack >= 0);
+  ASSERT_TRUE(usage.metadata >= (long) sizeof(M));
+  ASSERT_EQ(usage.payload + usage.overhead + usage.slack + usage.metadata, usage.total());
+  if (all_pmr)
+    ASSERT_EQ((long) sizeof(M) + r.outstanding, usage.total());
+  else
+    ASSERT_TRUE(usage.total() > (long) sizeof(M) + r.outstanding);
+}
+
+TEST(MemoryUsageTests, AllMapsCheck)
+{
+  check_memory_usage<ArrayMap<int,int>>(true);
+  check_memory_usage<BinSearchMap<int,int>>(true);
+  check_memory_usage<BinSearchMap<int,int,FlatSeq,LearnedSearch<>>>(true);
+  check_memory_usage<BinSearchMap<int,int,TieredSeq>>(false);
+  check_memory_usage<HashMap<int,int>>(true);
+  check_memory_usage<BSTMap<int,int>>(true);
+  check_memory_usage<BlockedSortedMap<int,int>>(false);
+}
+
+TEST(MemoryUsageTests, NodeOverheadCheck)
+{
+  HashMap<int,int> m1;
+  BSTMap<int,int> m2;
+  BinSearchMap<int,int> m3;
+  for (int i = 0; i < 10; ++i) {
+    m1.insert(i, i);
+    m2.insert(i, i);
+    m3.insert(i, i);
+  }
+  // a next pointer per hash node, two child pointers per tree node
+  ASSERT_EQ(10 * (long) sizeof(void*), m1.memory_usage().overhead);
+  ASSERT_EQ(10 * 2 * (long) sizeof(void*), m2.memory_usage().overhead);
+  ASSERT_EQ(0, m2.memory_usage().slack);
+  // buffered pairs carry a live flag
+  ASSERT_TRUE(m3.memory_usage().overhead > 0);
+  m3.flush();
+  ASSERT_EQ(0, m3.memory_usage().overhead);
+  ASSERT_EQ(10 * 2 * (long) sizeof(int), m3.memory_usage().payload);
+}
+
+TEST(MemoryUsageTests, SequencesCheck)
+{
+  ArraySeq<int,4> s1;
+  ASSERT_EQ(0, s1.memory_usage().payload);
+  ASSERT_EQ(4 * (long) sizeof(int), s1.memory_usage().slack);
+  ASSERT_EQ((long) sizeof(s1), s1.memory_usage().total());
+  for (int i = 0; i < 3; ++i)
+    s1.insert(i, i);
+  ASSERT_EQ(3 * (long) sizeof(int), s1.memory_usage().payload);
+  ASSERT_EQ(1 * (long) sizeof(int), s1.memory_usage().slack);
+  // once spilled, the inline slots are slack too
+  CountingResource r;
+  ArraySeq<int,4> s2(&r);
+  for (int i = 0; i < 10; ++i)
+    s2.insert(i, i);
+  MemoryUsage usage = s2.memory_usage();
+  ASSERT_EQ(10 * (long) sizeof(int), usage.payload);
+  ASSERT_EQ((long) sizeof(s2) + r.outstanding, usage.total());
+  ASSERT_EQ(4 * (long) sizeof(int) + r.outstanding - 10 * (long) sizeof(int), usage.slack);
+  FlatSeq<int> s3;
+  s3.reserve(100);
+  s3.insert(1, 0);
+  ASSERT_EQ(99 * (long) sizeof(int), s3.memory_usage().slack);
+  TieredSeq<int> s4;
+  for (int i = 0; i < 1000; ++i)
+    s4.insert(i, i);
+  ASSERT_EQ(1000 * (long) sizeof(int), s4.memory_usage().payload);
+  ASSERT_TRUE(s4.memory_usage().slack >= 0);
+  ASSERT_TRUE(s4.memory_usage().metadata > (long) sizeof(s4));
+}
+
+
+//----------------------------------------------------------------------
+// Operation Counter Tests (hw7_test is built with OP_COUNTERS)
+//----------------------------------------------------------------------
+
+TEST(OpCounterTests, ResetCheck)
+{
+  op_counters().comparisons = 5;
+  op_counters().reset();
+  ASSERT_EQ(0, op_counters().comparisons);
+}
+
+// without OP_COUNTERS (e.g., hw7_test.cpp compiled by hand), OP_COUNT
+// does nothing and the other counter tests are skipped
+TEST(OpCounterTests, CompiledOutCheck)
+{
+  if (op_counters_enabled)
+    GTEST_SKIP();
+  op_counters().reset();
+  BSTMap<int,int> m;
+  for (int i = 1; i <= 10; ++i)
+    m.insert(i, i);
+  FlatSeq<int> s;
+  s.insert(1, 0);
+  s.insert(0, 0);
+  ASSERT_EQ(0, op_counters().node_hops);
+  ASSERT_EQ(0, op_counters().moves);
+}
+
+TEST(OpCounterTests, BinarySearchComparisonsCheck)
+{
+  if (!op_counters_enabled)
+    GTEST_SKIP();
+  FlatSeq<int> keys;
+  for (int i = 0; i < 1024; ++i)
+    keys.insert(2 * i, i);
+  BinarySearch search;
+  op_counters().reset();
+  ASSERT_EQ(300, search.lower_bound(keys, 600));
+  // lg 1024 halvings plus the final comparison
+  ASSERT_EQ(11, op_counters().comparisons);
+  BinSearchMap<int,int> m;
+  for (int i = 0; i < 1024; ++i)
+    m.insert(i, i);
+  m.flush();
+  op_counters().reset();
+  ASSERT_TRUE(m.contains(600));
+  ASSERT_EQ(11, op_counters().comparisons);
+  ASSERT_EQ(0, op_counters().moves);
+}
+
+TEST(OpCounterTests, BinSearchMapBufferCheck)
+{
+  if (!op_counters_enabled)
+    GTEST_SKIP();
+  BinSearchMap<int,int> m;
+  for (int i = 0; i < 1024; ++i)
+    m.insert(2 * i, i);
+  m.flush();
+  // writes search the buffer and the arrays, and lookups of buffered
+  // keys are answered from the buffer alone
+  op_counters().reset();
+  m.insert(1, 1);
+  ASSERT_TRUE(op_counters().comparisons > 0);
+  op_counters().reset();
+  ASSERT_TRUE(m.contains(1));
+  ASSERT_TRUE(op_counters().comparisons > 0);
+  op_counters().reset();
+  m.erase(1);
+  ASSERT_TRUE(op_counters().comparisons > 0);
+  // merging the runs and the arrays moves pairs
+  op_counters().reset();
+  for (int i = 0; i < 10; ++i)
+    m.insert(2 * i + 1, i);
+  ASSERT_TRUE(op_counters().moves > 0);
+  op_counters().reset();
+  m.flush();
+  ASSERT_TRUE(op_counters().moves >= 1024);
+  ASSERT_TRUE(op_counters().comparisons > 0);
+  ASSERT_EQ(1034, m.size());
+}
+
+TEST(OpCounterTests, ArraySeqMovesCheck)
+{
+  if (!op_counters_enabled)
+    GTEST_SKIP();
+  FlatSeq<int> s;
+  for (int i = 0; i < 10; ++i)
+    s.insert(i, i);
+  op_counters().reset();
+  s.insert(-1, 0);
+  ASSERT_EQ(10, op_counters().moves);
+  s.erase(0);
+  ASSERT_EQ(20, op_counters().moves);
+  s.erase(9);
+  ASSERT_EQ(20, op_counters().moves);
+  ASSERT_EQ(4, s.index_of(4));
+  ASSERT_EQ(5, op_counters().comparisons);
+  ASSERT_EQ(-1, s.index_of(42));
+  ASSERT_EQ(5 + 9, op_counters().comparisons);
+}
+
+TEST(OpCounterTests, HashMapProbesCheck)
+{
+  if (!op_counters_enabled)
+    GTEST_SKIP();
+  HashMap<int,int> m;
+  m.insert(1, 1);
+  op_counters().reset();
+  ASSERT_TRUE(m.contains(1));
+  ASSERT_EQ(1, op_counters().probes);
+  // an empty chain walks no links
+  ASSERT_FALSE(m.contains(2));
+  ASSERT_EQ(1, op_counters().probes);
+  m.erase(1);
+  ASSERT_EQ(2, op_counters().probes);
+  ASSERT_EQ(0, op_counters().node_hops);
+}
+
+TEST(OpCounterTests, BSTMapNodeHopsCheck)
+{
+  if (!op_counters_enabled)
+    GTEST_SKIP();
+  BSTMap<int,int> m;
+  op_counters().reset();
+  // ascending keys build a chain: the k-th insert follows k-1 links
+  for (int i = 1; i <= 10; ++i)
+    m.insert(i, i);
+  ASSERT_EQ(45, op_counters().node_hops);
+  op_counters().reset();
+  ASSERT_TRUE(m.contains(1));
+  ASSERT_EQ(0, op_counters().node_hops);
+  ASSERT_TRUE(m.contains(10));
+  ASSERT_EQ(9, op_counters().node_hops);
+  ASSERT_EQ(0, op_counters().probes);
+}
+
+
+//----------------------------------------------------------------------
+// Static Interface Tests
+//----------------------------------------------------------------------
+
+// the traits accept every concrete sequence and map, and reject the
+// wrong interface or element types
+static_assert(is_sequence_of<ArraySeq<int>,int>, "ArraySeq is a Sequence");
+static_assert(is_sequence_of<TieredSeq<int>,int>, "TieredSeq is a Sequence");
+static_assert(!is_sequence_of<ArraySeq<int>,double>, "wrong element type");
+static_assert(!is_sequence_of<HashMap<int,int>,int>, "a Map isn't a Sequence");
+static_assert(is_map_of<ArrayMap<int,int>,int,int>, "ArrayMap is a Map");
+static_assert(is_map_of<BinSearchMap<int,int>,int,int>, "BinSearchMap is a Map");
+static_assert(is_map_of<HashMap<int,int>,int,int>, "HashMap is a Map");
+static_assert(is_map_of<BSTMap<int,int>,int,int>, "BSTMap is a Map");
+static_assert(is_map_of<AdaptiveMap<int,int>,int,int>, "AdaptiveMap is a Map");
+static_assert(is_map_of<BlockedSortedMap<int,int>,int,int>, "BlockedSortedMap is a Map");
+static_assert(is_map_of<PersistentBSTMap<int,int>,int,int>, "PersistentBSTMap is a Map");
+static_assert(!is_map_of<HashMap<int,double>,int,int>, "wrong value type");
+static_assert(!is_map_of<ArraySeq<int>,int,int>, "a Sequence isn't a Map");
+
+TEST(StaticInterfaceTests, GenericHelpersCheck)
+{
+  // util.h's helpers are templates over the concrete sequence type
+  ArraySeq<int> a;
+  TieredSeq<int> t;
+  load_in_order(a, 64);
+  load_in_order(t, 64);
+  faro_shuffle(a, 1);
+  faro_shuffle(t, 1);
+  for (int i = 0; i < 64; ++i)
+    ASSERT_EQ(a[i], t[i]);
+}
+
+
 //----------------------------------------------------------------------
 // Main
 //----------------------------------------------------------------------
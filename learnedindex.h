@@ -0,0 +1,135 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: learnedindex.h
+// DATE: Fall 2021
+// DESC: Learned index search strategy for BinSearchMap (see
+//       searchpolicy.h for the strategy interface). rebuild() fits
+//       the sorted keys with a piecewise-linear model of key ->
+//       position (PGM-style segments, each accurate to within Epsilon
+//       positions for every key it covers). lower_bound() finds the
+//       key's segment, predicts its position, and finishes with a
+//       binary search of only the 2*Epsilon+3 slots around the
+//       prediction. The model is a few words per segment, so it stays
+//       cache resident even when the keys don't. Needs arithmetic
+//       keys; the model is refit whenever BinSearchMap merges its
+//       write buffer.
+//---------------------------------------------------------------------------
+
+#ifndef LEARNEDINDEX_H
+#define LEARNEDINDEX_H
+
+#include <type_traits>
+#include <limits>
+#include "arrayseq.h"
+#include "searchpolicy.h"
+#include "memoryusage.h"
+
+
+template<int Epsilon = 32>
+class LearnedSearch
+{
+public:
+  template<typename S, typename K>
+  int lower_bound(const S& keys, const K& key) const
+  {
+    static_assert(std::is_arithmetic<K>::value,
+                  "LearnedSearch requires arithmetic keys");
+    int n = keys.size();
+    int segs = starts.size();
+    if (segs == 0 || double(key) < first_keys.unchecked_at(0))
+      return 0;
+    // last segment whose first key is <= key
+    double x = key;
+    int s = branchless_lower_bound(first_keys, 0, segs, x);
+    if (s == segs || x < first_keys.unchecked_at(s))
+      --s;
+    int start = starts.unchecked_at(s);
+    int end = s + 1 < segs ? starts.unchecked_at(s + 1) : n;
+    double offset = (x - first_keys.unchecked_at(s)) * slopes.unchecked_at(s);
+    int pos = offset < end - start ? start + (int) offset : end;
+    // the answer is within Epsilon (+1 for a key between two stored
+    // keys, +1 for rounding) of the prediction
+    int lo = pos - Epsilon - 2;
+    int hi = pos + Epsilon + 2;
+    lo = lo < start ? start : lo;
+    hi = hi > end ? end : hi;
+    int i = branchless_lower_bound(keys, lo, hi - lo, key);
+    // keys too large for a double to hold exactly can land in the
+    // wrong segment: check the answer and fall back to a full search
+    if ((i > 0 && !(keys.unchecked_at(i - 1) < key))
+        || (i < n && keys.unchecked_at(i) < key))
+      return branchless_lower_bound(keys, 0, n, key);
+    return i;
+  }
+
+  // Fits the segments in one pass over the keys with a shrinking
+  // cone: the slopes that keep every key of the current segment
+  // within Epsilon of its position narrow to [min_slope, max_slope]
+  // as keys are added, and a new segment starts when the range is
+  // empty. O(n).
+  template<typename S>
+  void rebuild(const S& keys)
+  {
+    first_keys = FlatSeq<double>();
+    slopes = FlatSeq<double>();
+    starts = FlatSeq<int>();
+    int n = keys.size();
+    int start = 0;
+    while (start < n) {
+      double x0 = keys.unchecked_at(start);
+      double min_slope = 0;
+      double max_slope = std::numeric_limits<double>::infinity();
+      int i = start + 1;
+      for (; i < n; ++i) {
+        double dx = double(keys.unchecked_at(i)) - x0;
+        double dy = i - start;
+        double lo = (dy - Epsilon) / dx;
+        double hi = (dy + Epsilon) / dx;
+        if (lo > max_slope || hi < min_slope)
+          break;
+        min_slope = lo > min_slope ? lo : min_slope;
+        max_slope = hi < max_slope ? hi : max_slope;
+      }
+      double slope = (i - start == 1) ? 0 : (min_slope + max_slope) / 2;
+      first_keys.insert(x0, first_keys.size());
+      slopes.insert(slope, slopes.size());
+      starts.insert(start, starts.size());
+      start = i;
+    }
+  }
+
+  // Returns the number of segments in the model
+  int segment_count() const
+  {
+    return starts.size();
+  }
+
+  // Returns the memory used by the model's segments, in bytes
+  long index_bytes() const
+  {
+    return (long) starts.size() * (2 * sizeof(double) + sizeof(int));
+  }
+
+  // Returns the bytes the model uses, including the object itself, all
+  // counted as metadata (see memoryusage.h)
+  MemoryUsage memory_usage() const
+  {
+    MemoryUsage usage = first_keys.memory_usage();
+    usage += slopes.memory_usage();
+    usage += starts.memory_usage();
+    usage = usage.as_metadata();
+    usage.metadata += sizeof(*this) - sizeof(first_keys) - sizeof(slopes) - sizeof(starts);
+    return usage;
+  }
+
+private:
+  // segment s covers positions [starts[s], starts[s+1]) and predicts
+  // starts[s] + (key - first_keys[s]) * slopes[s]. Keys are stored
+  // and compared as doubles.
+  FlatSeq<double> first_keys;
+  FlatSeq<double> slopes;
+  FlatSeq<int> starts;
+};
+
+
+#endif
@@ -18,6 +18,9 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include <algorithm>
+#include <type_traits>
+#include <utility>
 #include "arrayseq.h"
 
 
@@ -43,11 +46,39 @@ public:
   // given key is not in the collection. 
   virtual const V& operator[](const K& key) const = 0;
 
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws, so a miss costs
+  // no more than a hit (unlike operator[], which throws).
+  virtual V* find(const K& key) noexcept = 0;
+  virtual const V* find(const K& key) const noexcept = 0;
+
   // Extends the collection by adding the given key-value
   // pair. Assumes the key being added is not present in the
   // collection. Insert does not check if the key is present.
   virtual void insert(const K& key, const V& value) = 0;
 
+  // Same as above, but moves the key and value into the collection
+  virtual void insert(K&& key, V&& value) = 0;
+
+  // Inserts the key-value pair if the key is not in the collection,
+  // with a single lookup. Returns a pointer to the key's value, and
+  // true if the pair was inserted or false if the key was already
+  // present (its value is left unchanged).
+  virtual std::pair<V*,bool> try_insert(const K& key, const V& value) = 0;
+
+  // Same as above, but moves the key and value in if the pair is
+  // inserted (and leaves them untouched otherwise)
+  virtual std::pair<V*,bool> try_insert(K&& key, V&& value) = 0;
+
+  // Inserts the key-value pair, or assigns the value if the key is
+  // already in the collection, with a single lookup. Returns true if
+  // the pair was inserted.
+  virtual bool insert_or_assign(const K& key, const V& value) = 0;
+
+  // Same as above, but moves the value in, and the key if the pair is
+  // inserted
+  virtual bool insert_or_assign(K&& key, V&& value) = 0;
+
   // Shrinks the collection by removing the key-value pair with the
   // given key. Does not modify the collection if the collection does
   // not contain the key. Throws out_of_range if the given key is not
@@ -62,8 +93,95 @@ public:
 
   // Returns the keys in the collection in ascending sorted order
   virtual ArraySeq<K> sorted_keys() const = 0;  
+
+  // Batch forms of insert, erase, and contains. The defaults make one
+  // call per key; maps that can do better with the whole batch in
+  // hand override them.
+
+  // Inserts the pairs (keys[i], values[i]). Like insert, assumes none
+  // of the keys are in the collection (or repeated in the
+  // batch). Throws out_of_range if keys and values differ in size.
+  virtual void insert_batch(const ArraySeq<K>& keys, const ArraySeq<V>& values);
+
+  // Removes the pair with each of the given (distinct) keys. Throws
+  // out_of_range, before removing any pair, if a key is not in the
+  // collection.
+  virtual void erase_batch(const ArraySeq<K>& keys);
+
+  // Returns, for each of the given keys, whether it is in the
+  // collection
+  virtual ArraySeq<bool> contains_batch(const ArraySeq<K>& keys) const;
+
+protected:
+
+  // helper for insert_batch overrides
+  static void check_batch(const ArraySeq<K>& keys, const ArraySeq<V>& values){
+    if(keys.size() != values.size()){
+      throw std::out_of_range("Map<K,V>::insert_batch(keys, values)");
+    }
+  }
+
+  // helper for batch overrides: returns the indices of the keys in
+  // ascending key order
+  static FlatSeq<int> batch_order(const ArraySeq<K>& keys){
+    FlatSeq<int> order;
+    order.reserve(keys.size());
+    for(int i = 0; i < keys.size(); i++){
+      order.insert(i, i);
+    }
+    std::sort(order.begin(), order.end(), [&keys](int a, int b){
+      return keys.unchecked_at(a) < keys.unchecked_at(b);
+    });
+    return order;
+  }
+
+  // helper for erase_batch overrides
+  void check_present(const ArraySeq<K>& keys) const{
+    for(const K& key : keys){
+      if(!contains(key)){
+        throw std::out_of_range("Map<K,V>::erase_batch(keys)");
+      }
+    }
+  }
   
 };
 
 
+template<typename K, typename V>
+void Map<K,V>::insert_batch(const ArraySeq<K>& keys, const ArraySeq<V>& values)
+{
+  check_batch(keys, values);
+  for(int i = 0; i < keys.size(); i++){
+    insert(keys.unchecked_at(i), values.unchecked_at(i));
+  }
+}
+
+template<typename K, typename V>
+void Map<K,V>::erase_batch(const ArraySeq<K>& keys)
+{
+  check_present(keys);
+  for(const K& key : keys){
+    erase(key);
+  }
+}
+
+template<typename K, typename V>
+ArraySeq<bool> Map<K,V>::contains_batch(const ArraySeq<K>& keys) const
+{
+  ArraySeq<bool> found;
+  found.reserve(keys.size());
+  for(const K& key : keys){
+    found.insert(contains(key), found.size());
+  }
+  return found;
+}
+
+
+// Compile-time form of the interface (see is_sequence_of in
+// sequence.h). Templates over a concrete (final) map type M get
+// statically dispatched, inlinable calls.
+template<typename M, typename K, typename V>
+constexpr bool is_map_of = std::is_base_of<Map<K,V>, M>::value;
+
+
 #endif
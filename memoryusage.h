@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: memoryusage.h
+// DATE: Fall 2021
+// DESC: Breakdown of the bytes a container uses, as returned by the
+//       containers' memory_usage(). The total includes the container
+//       object itself. Sizes are shallow: an element counts as
+//       sizeof(T) (a pair as sizeof(K) + sizeof(V)), not including
+//       memory the element owns itself (e.g., a std::string's
+//       characters).
+//---------------------------------------------------------------------------
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <type_traits>
+#include <utility>
+
+
+struct MemoryUsage
+{
+  // the elements (or the keys and values) themselves
+  long payload = 0;
+
+  // bytes stored per element besides its payload (node links, flags,
+  // padding)
+  long overhead = 0;
+
+  // storage allocated for elements that aren't there (unused array
+  // capacity)
+  long slack = 0;
+
+  // everything else: the container object and the structures it keeps
+  // per container rather than per element (bucket arrays, indexes,
+  // caches)
+  long metadata = 0;
+
+  // Returns the number of bytes in all four parts
+  long total() const
+  {
+    return payload + overhead + slack + metadata;
+  }
+
+  // Returns the same bytes counted as metadata (for a structure a
+  // container keeps on the side, e.g., a sorted copy of its keys)
+  MemoryUsage as_metadata() const
+  {
+    MemoryUsage usage;
+    usage.metadata = total();
+    return usage;
+  }
+
+  MemoryUsage& operator+=(const MemoryUsage& rhs)
+  {
+    payload += rhs.payload;
+    overhead += rhs.overhead;
+    slack += rhs.slack;
+    metadata += rhs.metadata;
+    return *this;
+  }
+};
+
+
+// True if T has a memory_usage() member (used for optional parts such
+// as BinSearchMap's search policy)
+template<typename T, typename = void>
+constexpr bool has_memory_usage = false;
+
+template<typename T>
+constexpr bool has_memory_usage<T, std::void_t<decltype(std::declval<const T&>().memory_usage())>> = true;
+
+
+#endif
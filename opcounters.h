@@ -0,0 +1,68 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: opcounters.h
+// DATE: Fall 2021
+// DESC: Operation counters for hardware-independent cost data: key
+//       comparisons in the sorted-array and write-buffer searches,
+//       chain links walked in HashMap, node hops in BSTMap, and
+//       elements moved by ArraySeq's inserts and erases and by
+//       BinSearchMap's buffer merges. The containers count through
+//       OP_COUNT, which compiles to nothing unless OP_COUNTERS is
+//       defined (e.g., the hw7_perf_counts target), so normal builds
+//       pay nothing for the instrumentation.
+//---------------------------------------------------------------------------
+
+#ifndef OPCOUNTERS_H
+#define OPCOUNTERS_H
+
+
+struct OpCounters
+{
+  // key comparisons made by searches (binary, interpolation,
+  // exponential and linear)
+  long comparisons = 0;
+
+  // hash chain links walked
+  long probes = 0;
+
+  // tree links followed (from a node to its child)
+  long node_hops = 0;
+
+  // elements shifted to open or close a gap in an array, or moved
+  // by a merge (BinSearchMap's write buffer)
+  long moves = 0;
+
+  // Sets every counter back to zero
+  void reset()
+  {
+    *this = OpCounters();
+  }
+};
+
+
+// True if the counters are compiled in
+#ifdef OP_COUNTERS
+constexpr bool op_counters_enabled = true;
+#else
+constexpr bool op_counters_enabled = false;
+#endif
+
+
+// Returns the process-wide counters (not synchronized: count from one
+// thread at a time)
+inline OpCounters& op_counters()
+{
+  static OpCounters counters;
+  return counters;
+}
+
+
+// Adds n to the named counter, e.g. OP_COUNT(probes, 1)
+#ifdef OP_COUNTERS
+#define OP_COUNT(counter, n) (op_counters().counter += (n))
+#else
+#define OP_COUNT(counter, n) ((void) 0)
+#endif
+
+
+#endif
@@ -0,0 +1,572 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: persistentbstmap.h
+// DATE: Fall 2021
+// DESC: Persistent (copy-on-write) binary search tree. Nodes are
+//       reference counted and shared between copies of the map, so a
+//       copy or snapshot() is O(1). A write copies only the shared
+//       nodes on the root-to-leaf path it changes; every other
+//       version keeps seeing the old nodes. The tree is kept AVL
+//       balanced, so a path (and therefore a write) is O(log n).
+//       Nodes are freed when no version refers to them any more.
+//       A single map object is not thread-safe, but snapshots may
+//       be handed to reader threads while the writer keeps updating
+//       its own copy.
+//---------------------------------------------------------------------------
+
+#ifndef PERSISTENTBSTMAP_H
+#define PERSISTENTBSTMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include "map.h"
+#include "arrayseq.h"
+
+
+template<typename K, typename V>
+class PersistentBSTMap final : public Map<K,V>
+{
+public:
+
+  // Default constructor
+  PersistentBSTMap();
+
+  // Copy constructor (O(1): the copy shares every node)
+  PersistentBSTMap(const PersistentBSTMap& rhs);
+
+  // Move constructor
+  PersistentBSTMap(PersistentBSTMap&& rhs);
+
+  // Copy assignment operator (O(1), see the copy constructor)
+  PersistentBSTMap& operator=(const PersistentBSTMap& rhs);
+
+  // Move assignment operator
+  PersistentBSTMap& operator=(PersistentBSTMap&& rhs);
+
+  // Destructor
+  ~PersistentBSTMap();
+
+  // Returns an O(1) read-only version of the map as it is now. Later
+  // writes to this map do not show in the snapshot (or vice versa).
+  PersistentBSTMap snapshot() const;
+
+  // Returns the number of key-value pairs in the map
+  int size() const;
+
+  // Tests if the map is empty
+  bool empty() const;
+
+  // Allows values associated with a key to be updated. Throws
+  // out_of_range if the given key is not in the collection. Copies
+  // the shared nodes on the key's path first.
+  V& operator[](const K& key);
+
+  // Returns the value for a given key. Throws out_of_range if the
+  // given key is not in the collection.
+  const V& operator[](const K& key) const;
+
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection. Never throws (the non-const
+  // version copies the shared nodes on the key's path, like
+  // operator[], and terminates if that allocation fails).
+  V* find(const K& key) noexcept;
+  const V* find(const K& key) const noexcept;
+
+  // Extends the collection by adding the given key-value pair. If
+  // the key is already present the collection is left unchanged.
+  void insert(const K& key, const V& value);
+  void insert(K&& key, V&& value);
+
+  // Inserts the pair if the key is not present (see Map)
+  std::pair<V*,bool> try_insert(const K& key, const V& value);
+  std::pair<V*,bool> try_insert(K&& key, V&& value);
+
+  // Inserts the pair, or assigns the value if the key is present
+  // (see Map)
+  bool insert_or_assign(const K& key, const V& value);
+  bool insert_or_assign(K&& key, V&& value);
+
+  // Like try_insert, but the value is constructed from args, and only
+  // if the key is not present. The key is copied, or moved if it is
+  // an rvalue.
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> emplace(KK&& key, Args&&... args);
+
+  // Shrinks the collection by removing the key-value pair with the
+  // given key. Throws out_of_range if the given key is not in the
+  // collection.
+  void erase(const K& key);
+
+  // Returns true if the key is in the collection, and false
+  // otherwise.
+  bool contains(const K& key) const;
+
+  // Returns the keys k in the collection such that k1 <= k <= k2
+  ArraySeq<K> find_keys(const K& k1, const K& k2) const;
+
+  // Returns the keys in the collection in ascending sorted order.
+  ArraySeq<K> sorted_keys() const;
+
+  // Calls visit(key, value) on every pair in ascending key order,
+  // without allocating (the non-const version copies every shared
+  // node first). visit may modify the values, but must not otherwise
+  // modify the map.
+  template<typename F>
+  void for_each(F visit);
+  template<typename F>
+  void for_each(F visit) const;
+
+  // Like for_each, but only visits the keys k with k1 <= k <= k2,
+  // skipping the subtrees outside the range
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit);
+  template<typename F>
+  void for_each_in_range(const K& k1, const K& k2, F visit) const;
+
+  // Returns the height of the tree (0 if it is empty)
+  int height() const;
+
+private:
+
+  struct Node;
+  using Link = std::shared_ptr<Node>;
+
+  // tree node, shared by every version of the map that contains it
+  struct Node {
+    K key;
+    V value;
+    Link left;
+    Link right;
+    int height;
+  };
+
+  // number of key-value pairs in the map
+  int count = 0;
+
+  // root of this version of the tree
+  Link root;
+
+  // Makes the node at link safe to modify: if another version (or
+  // another parent) shares it, link is pointed at a private copy.
+  // Only called once every node above it has been made private, so
+  // a node that isn't shared is owned by this version alone.
+  // use_count() is a relaxed load, so when it says the node is ours
+  // the acquire fence orders the writes after the release of the
+  // last snapshot (possibly on a reader thread) that used it.
+  static Node* own(Link& link){
+    if(link.use_count() > 1){
+      link = std::make_shared<Node>(*link);
+    }
+    else {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return link.get();
+  }
+
+  static int height(const Link& link){
+    return link ? link->height : 0;
+  }
+
+  static void update_height(Node* node){
+    node->height = 1 + std::max(height(node->left), height(node->right));
+  }
+
+  // rotations and rebalancing (link's node must be private)
+  static void rotate_right(Link& link);
+  static void rotate_left(Link& link);
+  static void rebalance(Link& link);
+
+  // helper to find the node holding the key (nullptr if none)
+  const Node* find_node(const K& key) const{
+    const Node* node = root.get();
+    while(node != nullptr && !(key == node->key)){
+      node = key < node->key ? node->left.get() : node->right.get();
+    }
+    return node;
+  }
+
+  // helper to find the node holding the key for writing: copies the
+  // shared nodes on its path (nullptr, and no copies, if the key is
+  // not in the collection)
+  Node* own_node(const K& key){
+    if(find_node(key) == nullptr){
+      return nullptr;
+    }
+    Link* link = &root;
+    while(true){
+      Node* node = own(*link);
+      if(key == node->key){
+        return node;
+      }
+      link = key < node->key ? &node->left : &node->right;
+    }
+  }
+
+  // helper for the inserts: returns the key's value if the key is
+  // present, and otherwise adds the pair (key, make_value()) and
+  // rebalances the path back up. Either way the shared nodes on the
+  // path are copied first.
+  template<typename KK, typename F>
+  std::pair<V*,bool> find_or_insert(Link& link, KK&& key, F& make_value);
+
+  // erase helpers (the key must be in the subtree)
+  void erase(Link& link, const K& key);
+  static Link take_min(Link& link);
+
+  // in-order walk for the const visitors, find_keys and sorted_keys:
+  // calls visit(key, value) on the pairs with *k1 <= key <= *k2 (no
+  // bound if k1 or k2 is nullptr), skipping subtrees outside them
+  template<typename F>
+  static void walk(const Node* node, const K* k1, const K* k2, F& visit);
+
+  // the same walk for the non-const visitors, making every node
+  // private before visiting it
+  template<typename F>
+  static void walk_owned(Link& link, const K* k1, const K* k2, F& visit);
+
+};
+
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V>::PersistentBSTMap(){
+  }
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V>::PersistentBSTMap(const PersistentBSTMap& rhs)
+    : count(rhs.count), root(rhs.root){
+  }
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V>::PersistentBSTMap(PersistentBSTMap&& rhs){
+    *this = std::move(rhs);
+  }
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V>& PersistentBSTMap<K,V>::operator=(const PersistentBSTMap& rhs){
+    if(this != &rhs){
+      root = rhs.root;
+      count = rhs.count;
+    }
+    return *this;
+  }
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V>& PersistentBSTMap<K,V>::operator=(PersistentBSTMap&& rhs){
+    if(this != &rhs){
+      root = std::move(rhs.root);
+      count = rhs.count;
+      rhs.root = nullptr;
+      rhs.count = 0;
+    }
+    return *this;
+  }
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V>::~PersistentBSTMap(){
+  }
+
+  template<typename K, typename V>
+  PersistentBSTMap<K,V> PersistentBSTMap<K,V>::snapshot() const{
+    return *this;
+  }
+
+  template<typename K, typename V>
+  int PersistentBSTMap<K,V>::size() const{
+    return count;
+  }
+
+  template<typename K, typename V>
+  bool PersistentBSTMap<K,V>::empty() const{
+    return count == 0;
+  }
+
+  template<typename K, typename V>
+  V& PersistentBSTMap<K,V>::operator[](const K& key){
+    Node* node = own_node(key);
+    if(node == nullptr){
+      throw std::out_of_range("PersistentBSTMap<K,V>::operator[](const K& key)");
+    }
+    return node->value;
+  }
+
+  template<typename K, typename V>
+  const V& PersistentBSTMap<K,V>::operator[](const K& key) const{
+    const Node* node = find_node(key);
+    if(node == nullptr){
+      throw std::out_of_range("PersistentBSTMap<K,V>::operator[](const K& key)");
+    }
+    return node->value;
+  }
+
+  template<typename K, typename V>
+  V* PersistentBSTMap<K,V>::find(const K& key) noexcept{
+    Node* node = own_node(key);
+    return node != nullptr ? &node->value : nullptr;
+  }
+
+  template<typename K, typename V>
+  const V* PersistentBSTMap<K,V>::find(const K& key) const noexcept{
+    const Node* node = find_node(key);
+    return node != nullptr ? &node->value : nullptr;
+  }
+
+  template<typename K, typename V>
+  template<typename KK, typename F>
+  std::pair<V*,bool> PersistentBSTMap<K,V>::find_or_insert(Link& link, KK&& key, F& make_value){
+    if(!link){
+      link = std::make_shared<Node>(Node{std::forward<KK>(key), make_value(), nullptr, nullptr, 1});
+      ++count;
+      return {&link->value, true};
+    }
+    Node* node = own(link);
+    if(key == node->key){
+      return {&node->value, false};
+    }
+    std::pair<V*,bool> result = key < node->key
+      ? find_or_insert(node->left, std::forward<KK>(key), make_value)
+      : find_or_insert(node->right, std::forward<KK>(key), make_value);
+    if(result.second){
+      // rotations move nodes, but never the value the result points at
+      rebalance(link);
+    }
+    return result;
+  }
+
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::insert(const K& key, const V& value){
+    auto make_value = [&]() -> const V& {return value;};
+    find_or_insert(root, key, make_value);
+  }
+
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::insert(K&& key, V&& value){
+    auto make_value = [&]() -> V&& {return std::move(value);};
+    find_or_insert(root, std::move(key), make_value);
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> PersistentBSTMap<K,V>::try_insert(const K& key, const V& value){
+    auto make_value = [&]() -> const V& {return value;};
+    return find_or_insert(root, key, make_value);
+  }
+
+  template<typename K, typename V>
+  std::pair<V*,bool> PersistentBSTMap<K,V>::try_insert(K&& key, V&& value){
+    auto make_value = [&]() -> V&& {return std::move(value);};
+    return find_or_insert(root, std::move(key), make_value);
+  }
+
+  template<typename K, typename V>
+  bool PersistentBSTMap<K,V>::insert_or_assign(const K& key, const V& value){
+    std::pair<V*,bool> result = try_insert(key, value);
+    if(!result.second){
+      *result.first = value;
+    }
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  bool PersistentBSTMap<K,V>::insert_or_assign(K&& key, V&& value){
+    auto make_value = [&]() -> V&& {return std::move(value);};
+    std::pair<V*,bool> result = find_or_insert(root, std::move(key), make_value);
+    if(!result.second){
+      *result.first = std::move(value);
+    }
+    return result.second;
+  }
+
+  template<typename K, typename V>
+  template<typename KK, typename... Args>
+  std::pair<V*,bool> PersistentBSTMap<K,V>::emplace(KK&& key, Args&&... args){
+    auto make_value = [&]() {return V(std::forward<Args>(args)...);};
+    return find_or_insert(root, std::forward<KK>(key), make_value);
+  }
+
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::erase(const K& key){
+    if(find_node(key) == nullptr){
+      throw std::out_of_range("PersistentBSTMap<K,V>::erase(const K& key)");
+    }
+    erase(root, key);
+    --count;
+  }
+
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::erase(Link& link, const K& key){
+    Node* node = own(link);
+    if(key < node->key){
+      erase(node->left, key);
+    }
+    else if(node->key < key){
+      erase(node->right, key);
+    }
+    else if(!node->left || !node->right){
+      Link child = node->left ? std::move(node->left) : std::move(node->right);
+      link = std::move(child);
+      return;
+    }
+    else {
+      // replace the pair with its successor's
+      Link successor = take_min(node->right);
+      node->key = std::move(successor->key);
+      node->value = std::move(successor->value);
+    }
+    rebalance(link);
+  }
+
+  // Detaches the node with the smallest key from the subtree and
+  // returns it (private to this version, so it can be moved from)
+  template<typename K, typename V>
+  typename PersistentBSTMap<K,V>::Link PersistentBSTMap<K,V>::take_min(Link& link){
+    Node* node = own(link);
+    if(!node->left){
+      Link min = std::move(link);
+      link = std::move(min->right);
+      return min;
+    }
+    Link min = take_min(node->left);
+    rebalance(link);
+    return min;
+  }
+
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::rotate_right(Link& link){
+    Node* node = link.get();
+    own(node->left);
+    Link left = std::move(node->left);
+    node->left = std::move(left->right);
+    update_height(node);
+    left->right = std::move(link);
+    update_height(left.get());
+    link = std::move(left);
+  }
+
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::rotate_left(Link& link){
+    Node* node = link.get();
+    own(node->right);
+    Link right = std::move(node->right);
+    node->right = std::move(right->left);
+    update_height(node);
+    right->left = std::move(link);
+    update_height(right.get());
+    link = std::move(right);
+  }
+
+  // Restores the AVL balance at link after one of its subtrees grew
+  // or shrank by one level
+  template<typename K, typename V>
+  void PersistentBSTMap<K,V>::rebalance(Link& link){
+    Node* node = link.get();
+    update_height(node);
+    int balance = height(node->left) - height(node->right);
+    if(balance > 1){
+      if(height(node->left->left) < height(node->left->right)){
+        own(node->left);
+        rotate_left(node->left);
+      }
+      rotate_right(link);
+    }
+    else if(balance < -1){
+      if(height(node->right->right) < height(node->right->left)){
+        own(node->right);
+        rotate_right(node->right);
+      }
+      rotate_left(link);
+    }
+  }
+
+  template<typename K, typename V>
+  bool PersistentBSTMap<K,V>::contains(const K& key) const{
+    return find_node(key) != nullptr;
+  }
+
+  template<typename K, typename V>
+  ArraySeq<K> PersistentBSTMap<K,V>::find_keys(const K& k1, const K& k2) const{
+    ArraySeq<K> keys;
+    auto collect = [&keys](const K& key, const V&){keys.insert(key, keys.size());};
+    walk(root.get(), &k1, &k2, collect);
+    return keys;
+  }
+
+  template<typename K, typename V>
+  ArraySeq<K> PersistentBSTMap<K,V>::sorted_keys() const{
+    ArraySeq<K> keys;
+    keys.reserve(count);
+    auto collect = [&keys](const K& key, const V&){keys.insert(key, keys.size());};
+    walk(root.get(), nullptr, nullptr, collect);
+    return keys;
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void PersistentBSTMap<K,V>::walk(const Node* node, const K* k1, const K* k2, F& visit){
+    if(node == nullptr){
+      return;
+    }
+    bool above_k1 = k1 == nullptr || *k1 < node->key;
+    bool below_k2 = k2 == nullptr || node->key < *k2;
+    if(above_k1){
+      walk(node->left.get(), k1, k2, visit);
+    }
+    if((above_k1 || !(node->key < *k1)) && (below_k2 || !(*k2 < node->key))){
+      visit(node->key, static_cast<const V&>(node->value));
+    }
+    if(below_k2){
+      walk(node->right.get(), k1, k2, visit);
+    }
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void PersistentBSTMap<K,V>::walk_owned(Link& link, const K* k1, const K* k2, F& visit){
+    if(!link){
+      return;
+    }
+    Node* node = own(link);
+    bool above_k1 = k1 == nullptr || *k1 < node->key;
+    bool below_k2 = k2 == nullptr || node->key < *k2;
+    if(above_k1){
+      walk_owned(node->left, k1, k2, visit);
+    }
+    if((above_k1 || !(node->key < *k1)) && (below_k2 || !(*k2 < node->key))){
+      visit(static_cast<const K&>(node->key), node->value);
+    }
+    if(below_k2){
+      walk_owned(node->right, k1, k2, visit);
+    }
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void PersistentBSTMap<K,V>::for_each(F visit){
+    walk_owned(root, nullptr, nullptr, visit);
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void PersistentBSTMap<K,V>::for_each(F visit) const{
+    walk(root.get(), nullptr, nullptr, visit);
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void PersistentBSTMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit){
+    walk_owned(root, &k1, &k2, visit);
+  }
+
+  template<typename K, typename V>
+  template<typename F>
+  void PersistentBSTMap<K,V>::for_each_in_range(const K& k1, const K& k2, F visit) const{
+    walk(root.get(), &k1, &k2, visit);
+  }
+
+  template<typename K, typename V>
+  int PersistentBSTMap<K,V>::height() const{
+    return height(root);
+  }
+
+#endif
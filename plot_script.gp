@@ -22,6 +22,8 @@ outfile3 = "contains_graph.png"
 outfile4 = "find_range_graph.png"
 outfile5 = "sorted_keys_graph.png"
 outfile6 = "bst_stats.png"
+outfile7 = "memory_graph.png"
+outfile8 = "memory_per_pair_graph.png"
 
 # color scheme
 RED = "#e6194B"
@@ -71,52 +73,57 @@ set yrange [0:*] noreverse writeback
 set output outfile1
 
 # Plot the data
-set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap Insert Performance";
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Insert Performance";
 plot  infile u 1:2 t "BinSearchMap Insert" w linespoints lw 3 lc rgb RED pointtype 6, \
       infile u 1:3 t "ArrayMap Insert" w linespoints lw 3 lc rgb GREEN pointtype 6, \
       infile u 1:4 t "HashMap Insert" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
-      infile u 1:5 t "BSTMap Insert" w linespoints lw 3 lc rgb BLUE pointtype 6;
+      infile u 1:5 t "BSTMap Insert" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:24 t "BlockedSortedMap Insert" w linespoints lw 3 lc rgb PURPLE pointtype 6;
 
 
 # Save the graph
 set output outfile2
 
 # Plot the data
-set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap Erase Performance";
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Erase Performance";
 plot  infile u 1:6 t "BinSearchMap Erase" w linespoints lw 3 lc rgb RED pointtype 6, \
       infile u 1:7 t "ArrayMap Erase" w linespoints lw 3 lc rgb GREEN pointtype 6, \
       infile u 1:8 t "HashMap Erase" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
-      infile u 1:9 t "BSTMap Erase" w linespoints lw 3 lc rgb BLUE pointtype 6;
+      infile u 1:9 t "BSTMap Erase" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:25 t "BlockedSortedMap Erase" w linespoints lw 3 lc rgb PURPLE pointtype 6;
 
 # Save the graph
 set output outfile3
 
 # Plot the data
-set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap Contains Performance";
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Contains Performance";
 plot  infile u 1:10 t "BinSearchMap Contains" w linespoints lw 3 lc rgb RED pointtype 6, \
       infile u 1:11 t "ArrayMap Contains" w linespoints lw 3 lc rgb GREEN pointtype 6, \
       infile u 1:12 t "HashMap Contains" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
-      infile u 1:13 t "BSTMap Contains" w linespoints lw 3 lc rgb BLUE pointtype 6;
+      infile u 1:13 t "BSTMap Contains" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:26 t "BlockedSortedMap Contains" w linespoints lw 3 lc rgb PURPLE pointtype 6;
       
 # Save the graph
 set output outfile4
 
 # Plot the data
-set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap Find Range Performance";
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Find Range Performance";
 plot  infile u 1:14 t "BinSearchMap Find Range" w linespoints lw 3 lc rgb RED pointtype 6, \
       infile u 1:15 t "ArrayMap Find Range" w linespoints lw 3 lc rgb GREEN pointtype 6, \
       infile u 1:16 t "HashMap Find Range" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
-      infile u 1:17 t "BSTMap Find Range" w linespoints lw 3 lc rgb BLUE pointtype 6;
+      infile u 1:17 t "BSTMap Find Range" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:27 t "BlockedSortedMap Find Range" w linespoints lw 3 lc rgb PURPLE pointtype 6;
 
 # Save the graph
 set output outfile5
 
 # Plot the data
-set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap Sorted Keys Performance";
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Sorted Keys Performance";
 plot  infile u 1:18 t "BinSearchMap Sorted Keys" w linespoints lw 3 lc rgb RED pointtype 6, \
       infile u 1:19 t "ArrayMap Sorted Keys" w linespoints lw 3 lc rgb GREEN pointtype 6, \
       infile u 1:20 t "HashMap Sorted Keys" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
-      infile u 1:21 t "BSTMap Sorted Keys" w linespoints lw 3 lc rgb BLUE pointtype 6; 
+      infile u 1:21 t "BSTMap Sorted Keys" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:28 t "BlockedSortedMap Sorted Keys" w linespoints lw 3 lc rgb PURPLE pointtype 6; 
 
 # Save the graph
 set output outfile6
@@ -127,6 +134,26 @@ set title "BSTMap Tree Height vs lg Growth";
 plot  infile u 1:22 t "BST Height" w linespoints lw 3 lc rgb BLUE pointtype 6, \
       infile u 1:23 t "lg n" w linespoints lw 3 lc rgb RED pointtype 6;
 
+# Save the graph
+set output outfile7
+
+set ylabel "Memory (KiB)"
 
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Memory Usage";
+plot  infile u 1:29 t "BinSearchMap Memory" w linespoints lw 3 lc rgb RED pointtype 6, \
+      infile u 1:30 t "ArrayMap Memory" w linespoints lw 3 lc rgb GREEN pointtype 6, \
+      infile u 1:31 t "HashMap Memory" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
+      infile u 1:32 t "BSTMap Memory" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:33 t "BlockedSortedMap Memory" w linespoints lw 3 lc rgb PURPLE pointtype 6;
+
+# Save the graph
+set output outfile8
 
+set ylabel "Bytes per Pair (beyond the payload)"
 
+set title "BinSearchMap vs ArrayMap vs HashMap vs BSTMap vs BlockedSortedMap Memory Overhead";
+plot  infile u 1:34 t "BinSearchMap Overhead" w linespoints lw 3 lc rgb RED pointtype 6, \
+      infile u 1:35 t "ArrayMap Overhead" w linespoints lw 3 lc rgb GREEN pointtype 6, \
+      infile u 1:36 t "HashMap Overhead" w linespoints lw 3 lc rgb YELLOW pointtype 6, \
+      infile u 1:37 t "BSTMap Overhead" w linespoints lw 3 lc rgb BLUE pointtype 6, \
+      infile u 1:38 t "BlockedSortedMap Overhead" w linespoints lw 3 lc rgb PURPLE pointtype 6;
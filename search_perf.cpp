@@ -0,0 +1,285 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: search_perf.cpp
+// DATE: Fall 2021
+// DESC: Lookup latency microbenchmark for BinSearchMap. For key counts
+//       from a few thousand (L1/L2 resident) up to tens of millions
+//       (RAM resident) it times random successful lookups. To run
+//       from the command line use:
+//          ./search_perf > search.dat
+//       To instead time loading n shuffled keys into an empty map,
+//       use:
+//          ./search_perf ingest > ingest.dat
+//       To compare the search strategies in searchpolicy.h on
+//       uniformly spread and on clustered keys, use:
+//          ./search_perf strategies > strategies.dat
+//       To compare binary search with the learned index in
+//       learnedindex.h up to 16M keys, use:
+//          ./search_perf learned > learned.dat
+//---------------------------------------------------------------------------
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include "arrayseq.h"
+#include "binsearchmap.h"
+#include "searchpolicy.h"
+#include "learnedindex.h"
+
+
+using namespace std;
+using namespace std::chrono;
+
+
+// test parameters
+const int min_exp = 10;
+const int max_exp = 24;
+const int lookups = 1000000;
+const int max_ingest_exp = 20;
+const int max_strategy_exp = 22;
+const int min_learned_exp = 16;
+
+
+// simple deterministic pseudo-random numbers (64-bit LCG)
+unsigned long long next_random(unsigned long long& state)
+{
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 33;
+}
+
+// the original branchy search (three-way compare per step), for
+// comparison
+bool branchy_search(const ArraySeq<int>& keys, int key)
+{
+  int start = 0;
+  int end = keys.size() - 1;
+  while (start <= end) {
+    int mid = (end - start) / 2 + start;
+    int mid_key = keys.unchecked_at(mid);
+    if (key == mid_key)
+      return true;
+    if (key < mid_key)
+      end = mid - 1;
+    else
+      start = mid + 1;
+  }
+  return false;
+}
+
+// average nanoseconds per lookup of the probe keys using f
+template<typename F>
+double time_lookups(const ArraySeq<int,0>& probes, F f)
+{
+  int found = 0;
+  auto t0 = high_resolution_clock::now();
+  for (int key : probes)
+    found += f(key) ? 1 : 0;
+  auto t1 = high_resolution_clock::now();
+  if (found != probes.size())
+    cerr << "lookup missed a key" << endl;
+  return duration_cast<nanoseconds>(t1 - t0).count() / (double) probes.size();
+}
+
+
+// times inserting the keys 1..n in shuffled order into an empty map
+void ingest_benchmark()
+{
+  cout << "# Column 1 = number of keys" << endl;
+  cout << "# Column 2 = binsearch map insert all keys (msec)" << endl;
+  cout << "# Column 3 = column 2 in nanoseconds / (n lg n)" << endl;
+
+  unsigned long long state = 223;
+  for (int e = 10; e <= max_ingest_exp; e += 2) {
+    int n = 1 << e;
+    ArraySeq<int,0> keys;
+    keys.reserve(n);
+    for (int i = 0; i < n; ++i)
+      keys.insert(i + 1, i);
+    for (int i = n - 1; i > 0; --i)
+      std::swap(keys.unchecked_at(i), keys.unchecked_at(next_random(state) % (i + 1)));
+
+    BinSearchMap<int,int> m;
+    auto t0 = high_resolution_clock::now();
+    for (int key : keys)
+      m.insert(key, key);
+    m.flush();
+    auto t1 = high_resolution_clock::now();
+    double ns = duration_cast<nanoseconds>(t1 - t0).count();
+    cout << n << " " << ns / 1e6 << " " << ns / (n * log2(n)) << endl;
+  }
+}
+
+
+// makes n uniform keys (evenly spaced with jitter) and n clustered
+// keys (64 dense clusters spread out polynomially), plus random probes
+// of each
+void make_keys(int n, unsigned long long& state,
+               ArraySeq<long,0>& uniform, ArraySeq<long,0>& clustered,
+               ArraySeq<long,0>& uniform_probes, ArraySeq<long,0>& clustered_probes)
+{
+  uniform.reserve(n);
+  clustered.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    uniform.insert(16L * i + (long) (next_random(state) % 16), i);
+    long cluster = i / (n / 64);
+    clustered.insert(cluster * cluster * cluster * cluster * 1000L + i, i);
+  }
+  for (int i = 0; i < lookups; ++i) {
+    uniform_probes.insert(uniform[next_random(state) % n], i);
+    clustered_probes.insert(clustered[next_random(state) % n], i);
+  }
+}
+
+// builds a map with the given (sorted) keys and the Search strategy,
+// and returns the average nanoseconds per lookup of the probe keys
+template<typename Search>
+double time_strategy(const ArraySeq<long,0>& keys, const ArraySeq<long,0>& probes)
+{
+  BinSearchMap<long,long,FlatSeq,Search> m;
+  for (long key : keys)
+    m.insert(key, key);
+  m.flush();
+  int found = 0;
+  auto t0 = high_resolution_clock::now();
+  for (long key : probes)
+    found += m.contains(key) ? 1 : 0;
+  auto t1 = high_resolution_clock::now();
+  if (found != probes.size())
+    cerr << "lookup missed a key" << endl;
+  return duration_cast<nanoseconds>(t1 - t0).count() / (double) probes.size();
+}
+
+// times each search strategy on uniform keys (evenly spaced with
+// jitter) and clustered keys (64 dense clusters spread out
+// polynomially)
+void strategy_benchmark()
+{
+  cout << "# All times in nanoseconds per lookup" << endl;
+  cout << "# Column 1 = number of keys" << endl;
+  cout << "# Column 2 = binary search, uniform keys" << endl;
+  cout << "# Column 3 = interpolation search, uniform keys" << endl;
+  cout << "# Column 4 = interpolation-sequential search, uniform keys" << endl;
+  cout << "# Column 5 = exponential search, uniform keys" << endl;
+  cout << "# Column 6 = binary search, clustered keys" << endl;
+  cout << "# Column 7 = interpolation search, clustered keys" << endl;
+  cout << "# Column 8 = interpolation-sequential search, clustered keys" << endl;
+  cout << "# Column 9 = exponential search, clustered keys" << endl;
+  cout << "# Column 10 = binary search, uniform keys in ascending order" << endl;
+  cout << "# Column 11 = exponential search, uniform keys in ascending order" << endl;
+
+  unsigned long long state = 223;
+  for (int e = min_exp; e <= max_strategy_exp; e += 2) {
+    int n = 1 << e;
+    ArraySeq<long,0> uniform, clustered, random_probes, clustered_probes, in_order;
+    make_keys(n, state, uniform, clustered, random_probes, clustered_probes);
+    for (int i = 0; i < lookups; ++i)
+      in_order.insert(uniform[(int) ((long) i * n / lookups)], i);
+    cout << n
+         << " " << time_strategy<BinarySearch>(uniform, random_probes)
+         << " " << time_strategy<InterpolationSearch>(uniform, random_probes)
+         << " " << time_strategy<InterpolationSequentialSearch>(uniform, random_probes)
+         << " " << time_strategy<ExponentialSearch>(uniform, random_probes)
+         << " " << time_strategy<BinarySearch>(clustered, clustered_probes)
+         << " " << time_strategy<InterpolationSearch>(clustered, clustered_probes)
+         << " " << time_strategy<InterpolationSequentialSearch>(clustered, clustered_probes)
+         << " " << time_strategy<ExponentialSearch>(clustered, clustered_probes)
+         << " " << time_strategy<BinarySearch>(uniform, in_order)
+         << " " << time_strategy<ExponentialSearch>(uniform, in_order)
+         << endl;
+  }
+}
+
+// times the learned index against binary search, and reports the size
+// of the learned model
+template<int Epsilon>
+void time_learned(const ArraySeq<long,0>& keys, const ArraySeq<long,0>& probes)
+{
+  BinSearchMap<long,long,FlatSeq,LearnedSearch<Epsilon>> m;
+  for (long key : keys)
+    m.insert(key, key);
+  m.flush();
+  int found = 0;
+  auto t0 = high_resolution_clock::now();
+  for (long key : probes)
+    found += m.contains(key) ? 1 : 0;
+  auto t1 = high_resolution_clock::now();
+  if (found != probes.size())
+    cerr << "lookup missed a key" << endl;
+  cout << " " << duration_cast<nanoseconds>(t1 - t0).count() / (double) probes.size()
+       << " " << m.search_policy().segment_count()
+       << " " << m.search_policy().index_bytes() / 1024.0;
+}
+
+void learned_benchmark()
+{
+  cout << "# Times in nanoseconds per lookup, sizes in KB" << endl;
+  cout << "# Column 1 = number of keys" << endl;
+  cout << "# Column 2 = key array size" << endl;
+  cout << "# Column 3 = binary search, uniform keys" << endl;
+  cout << "# Column 4 = learned index (epsilon 32), uniform keys" << endl;
+  cout << "# Column 5 = segments in column 4's model" << endl;
+  cout << "# Column 6 = size of column 4's model" << endl;
+  cout << "# Column 7 = binary search, clustered keys" << endl;
+  cout << "# Column 8 = learned index (epsilon 32), clustered keys" << endl;
+  cout << "# Column 9 = segments in column 8's model" << endl;
+  cout << "# Column 10 = size of column 8's model" << endl;
+
+  unsigned long long state = 223;
+  for (int e = min_learned_exp; e <= max_exp; e += 2) {
+    int n = 1 << e;
+    ArraySeq<long,0> uniform, clustered, uniform_probes, clustered_probes;
+    make_keys(n, state, uniform, clustered, uniform_probes, clustered_probes);
+    cout << n << " " << n * sizeof(long) / 1024.0;
+    cout << " " << time_strategy<BinarySearch>(uniform, uniform_probes);
+    time_learned<32>(uniform, uniform_probes);
+    cout << " " << time_strategy<BinarySearch>(clustered, clustered_probes);
+    time_learned<32>(clustered, clustered_probes);
+    cout << endl;
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  cout << fixed << showpoint;
+  cout << setprecision(2);
+
+  if (argc > 1 && string(argv[1]) == "ingest") {
+    ingest_benchmark();
+    return 0;
+  }
+  if (argc > 1 && string(argv[1]) == "strategies") {
+    strategy_benchmark();
+    return 0;
+  }
+  if (argc > 1 && string(argv[1]) == "learned") {
+    learned_benchmark();
+    return 0;
+  }
+
+  cout << "# All times in nanoseconds per lookup" << endl;
+  cout << "# Column 1 = number of keys" << endl;
+  cout << "# Column 2 = key array size in KB" << endl;
+  cout << "# Column 3 = binsearch map contains (branchless)" << endl;
+  cout << "# Column 4 = branchy binary search" << endl;
+
+  unsigned long long state = 223;
+  for (int e = min_exp; e <= max_exp; e += 2) {
+    int n = 1 << e;
+    // keys 2, 4, ..., 2n (inserted in order, so no shifting)
+    BinSearchMap<int,int> m;
+    for (int i = 1; i <= n; ++i)
+      m.insert(2 * i, i);
+    ArraySeq<int> keys = m.sorted_keys();
+    ArraySeq<int,0> probes;
+    probes.reserve(lookups);
+    for (int i = 0; i < lookups; ++i)
+      probes.insert(2 * (int)(next_random(state) % n + 1), i);
+
+    double c3 = time_lookups(probes, [&m](int k){return m.contains(k);});
+    double c4 = time_lookups(probes, [&keys](int k){return branchy_search(keys, k);});
+    cout << n << " " << (n * sizeof(int)) / 1024 << " " << c3 << " " << c4 << endl;
+  }
+}
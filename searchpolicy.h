@@ -0,0 +1,256 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: searchpolicy.h
+// DATE: Fall 2021
+// DESC: Search strategies for BinSearchMap's sorted key array, picked
+//       at compile time through the map's Search template parameter.
+//       Every strategy provides:
+//
+//         template<typename S, typename K>
+//         int lower_bound(const S& keys, const K& key) const;
+//           -- index of the first element of keys (a sorted sequence
+//              with unchecked_at and size) not less than key, or
+//              keys.size() if there is none. It is const so that
+//              const lookups on a shared map can run concurrently.
+//
+//         template<typename S>
+//         void rebuild(const S& keys);
+//           -- called whenever the sorted keys have changed
+//
+//       BinarySearch works for any key type. InterpolationSearch and
+//       InterpolationSequentialSearch need arithmetic keys; they
+//       estimate a key's position from its value and fall back to
+//       bisection when the keys are not evenly spread, so they never
+//       do worse than O(log n). ExponentialSearch gallops out from the
+//       previous result, which suits lookups that move through the
+//       keys in order.
+//---------------------------------------------------------------------------
+
+#ifndef SEARCHPOLICY_H
+#define SEARCHPOLICY_H
+
+#include <type_traits>
+#include "opcounters.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SEARCH_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define SEARCH_PREFETCH(addr)
+#endif
+
+
+//----------------------------------------------------------------------
+// Branchless binary search over keys[lo, lo+n): returns the index of
+// the first key not less than key (lo+n if there is none). Each step
+// halves the range with a conditional move rather than a branch on the
+// comparison, so there is nothing to mispredict, and both possible
+// next midpoints are prefetched so that their cache misses overlap
+// with the current comparison.
+//----------------------------------------------------------------------
+template<typename S, typename K>
+int branchless_lower_bound(const S& keys, int lo, int n, const K& key)
+{
+  if (n <= 0)
+    return lo;
+  int base = lo;
+  while (n > 1) {
+    int half = n / 2;
+    int next = (n - half) / 2;
+    SEARCH_PREFETCH(&keys.unchecked_at(base + next));
+    SEARCH_PREFETCH(&keys.unchecked_at(base + half + next));
+    base = (keys.unchecked_at(base + half) < key) ? base + half : base;
+    n -= half;
+    OP_COUNT(comparisons, 1);
+  }
+  OP_COUNT(comparisons, 1);
+  return base + ((keys.unchecked_at(base) < key) ? 1 : 0);
+}
+
+
+// Plain (branchless) binary search
+class BinarySearch
+{
+public:
+  template<typename S, typename K>
+  int lower_bound(const S& keys, const K& key) const
+  {
+    return branchless_lower_bound(keys, 0, keys.size(), key);
+  }
+
+  template<typename S>
+  void rebuild(const S&) {}
+};
+
+
+// Interpolation search: probes where the key would be if the keys
+// were evenly spread between the current bounds. About lg lg n probes
+// on uniform keys. As soon as a probe fails to halve the range the
+// rest of the search is a binary search, which bounds the work at
+// about lg n probes (plus the interpolation probes) on skewed keys.
+class InterpolationSearch
+{
+public:
+  template<typename S, typename K>
+  int lower_bound(const S& keys, const K& key) const
+  {
+    static_assert(std::is_arithmetic<K>::value,
+                  "InterpolationSearch requires arithmetic keys");
+    int n = keys.size();
+    OP_COUNT(comparisons, n == 0 ? 0 : 2);
+    if (n == 0 || !(keys.unchecked_at(0) < key))
+      return 0;
+    if (keys.unchecked_at(n - 1) < key)
+      return n;
+    // invariant: keys[lo] < key <= keys[hi]
+    int lo = 0;
+    int hi = n - 1;
+    while (hi - lo > 1) {
+      int width = hi - lo;
+      double lo_key = keys.unchecked_at(lo);
+      double hi_key = keys.unchecked_at(hi);
+      // distinct keys can round to the same double (e.g., 64-bit keys
+      // above 2^53): no slope to interpolate along
+      if (!(hi_key > lo_key))
+        return branchless_lower_bound(keys, lo + 1, hi - lo, key);
+      double frac = (double(key) - lo_key) / (hi_key - lo_key);
+      int pos = lo + (int) (frac * width);
+      pos = pos <= lo ? lo + 1 : (pos >= hi ? hi - 1 : pos);
+      OP_COUNT(comparisons, 1);
+      if (keys.unchecked_at(pos) < key)
+        lo = pos;
+      else
+        hi = pos;
+      // keys aren't evenly spread here: finish with binary search
+      if (hi - lo > width / 2)
+        return branchless_lower_bound(keys, lo + 1, hi - lo, key);
+    }
+    return hi;
+  }
+
+  template<typename S>
+  void rebuild(const S&) {}
+};
+
+
+// Interpolation-sequential search: a single interpolation probe
+// followed by a linear scan toward the key. Very fast when the keys
+// are close to uniform (the probe lands within a few slots); the scan
+// is limited to max_scan slots, after which it falls back to binary
+// search on the remaining side.
+class InterpolationSequentialSearch
+{
+public:
+  template<typename S, typename K>
+  int lower_bound(const S& keys, const K& key) const
+  {
+    static_assert(std::is_arithmetic<K>::value,
+                  "InterpolationSequentialSearch requires arithmetic keys");
+    int n = keys.size();
+    OP_COUNT(comparisons, n == 0 ? 0 : 2);
+    if (n == 0 || !(keys.unchecked_at(0) < key))
+      return 0;
+    if (keys.unchecked_at(n - 1) < key)
+      return n;
+    double lo_key = keys.unchecked_at(0);
+    double hi_key = keys.unchecked_at(n - 1);
+    // the ends can round to the same double (see InterpolationSearch)
+    if (!(hi_key > lo_key))
+      return branchless_lower_bound(keys, 1, n - 2, key);
+    int pos = (int) ((double(key) - lo_key) / (hi_key - lo_key) * (n - 1));
+    pos = pos < 1 ? 1 : (pos > n - 1 ? n - 1 : pos);
+    OP_COUNT(comparisons, 1);
+    if (keys.unchecked_at(pos) < key) {
+      // answer is after pos
+      for (int i = 1; i <= max_scan; ++i) {
+        OP_COUNT(comparisons, 1);
+        if (!(keys.unchecked_at(pos + i) < key))
+          return pos + i;
+      }
+      int lo = pos + max_scan + 1;
+      return branchless_lower_bound(keys, lo, n - lo, key);
+    }
+    // answer is at or before pos (and after 0)
+    for (int i = 0; i < max_scan; ++i) {
+      OP_COUNT(comparisons, 1);
+      if (keys.unchecked_at(pos - i - 1) < key)
+        return pos - i;
+    }
+    return branchless_lower_bound(keys, 1, pos - max_scan, key);
+  }
+
+  template<typename S>
+  void rebuild(const S&) {}
+
+private:
+  // longest linear scan before falling back to binary search
+  static constexpr int max_scan = 16;
+};
+
+
+// Exponential (galloping) search from a hint: the result of the
+// previous lookup on the same thread. Steps of 1, 2, 4, ... bracket
+// the key, then binary search finishes inside the bracket. O(log d)
+// for a key d slots from the previous one, so sequential or clustered
+// access patterns cost nearly O(1) per lookup. The hint is kept per
+// thread rather than in the strategy, so threads sharing a map don't
+// race on it; a hint left by another map only lengthens the gallop.
+class ExponentialSearch
+{
+public:
+  template<typename S, typename K>
+  int lower_bound(const S& keys, const K& key) const
+  {
+    int n = keys.size();
+    if (n == 0)
+      return 0;
+    int& hint = thread_hint();
+    int start = hint < n ? hint : n - 1;
+    int lo, hi;
+    OP_COUNT(comparisons, 1);
+    if (keys.unchecked_at(start) < key) {
+      // gallop right: keys[lo] < key
+      lo = start;
+      int step = 1;
+      hi = lo + step;
+      while (hi < n && keys.unchecked_at(hi) < key) {
+        OP_COUNT(comparisons, 1);
+        lo = hi;
+        step *= 2;
+        hi = lo + step;
+      }
+      if (hi > n)
+        hi = n;
+      hint = branchless_lower_bound(keys, lo + 1, hi - lo - 1, key);
+    }
+    else {
+      // gallop left: key <= keys[hi]
+      hi = start;
+      int step = 1;
+      lo = hi - step;
+      while (lo >= 0 && !(keys.unchecked_at(lo) < key)) {
+        OP_COUNT(comparisons, 1);
+        hi = lo;
+        step *= 2;
+        lo = hi - step;
+      }
+      if (lo < -1)
+        lo = -1;
+      hint = branchless_lower_bound(keys, lo + 1, hi - lo - 1, key);
+    }
+    return hint;
+  }
+
+  template<typename S>
+  void rebuild(const S&) {}
+
+private:
+  // result of the previous lookup on this thread
+  static int& thread_hint()
+  {
+    static thread_local int hint = 0;
+    return hint;
+  }
+};
+
+
+#endif
@@ -9,6 +9,8 @@
 #ifndef SEQUENCE_H
 #define SEQUENCE_H
 
+#include <type_traits>
+
 // TODO: Add detail and formatting for function comments. Include
 // clear details
 
@@ -41,6 +43,9 @@ public:
   // greater than size()).
   virtual void insert(const T& elem, int index) = 0;
 
+  // Same as above, but moves the element into the sequence
+  virtual void insert(T&& elem, int index) = 0;
+
   // Shrinks the sequence by removing the element at the index in the
   // sequence. Throws out_of_range if index is invalid.
   virtual void erase(int index) = 0;
@@ -56,4 +61,13 @@ public:
 };
 
 
+// Compile-time form of the interface. Generic code (e.g., util.h)
+// can be written as a template over the concrete sequence type Seq
+// instead of taking a Sequence<T>&; since the concrete classes are
+// final, every call is then resolved statically and can be inlined.
+// The virtual interface above remains for runtime polymorphism.
+template<typename Seq, typename T>
+constexpr bool is_sequence_of = std::is_base_of<Sequence<T>, Seq>::value;
+
+
 #endif
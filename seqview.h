@@ -0,0 +1,54 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: seqview.h
+// DATE: Fall 2021
+// DESC: Non-owning, read-only view (pointer plus length) over a
+//       contiguous run of elements owned by some other container. A
+//       view is only valid until the owning container is modified.
+//---------------------------------------------------------------------------
+
+#ifndef SEQVIEW_H
+#define SEQVIEW_H
+
+#include <stdexcept>
+
+
+template<typename T>
+class SeqView
+{
+public:
+
+  // Creates an empty view
+  SeqView() {}
+
+  // Creates a view of the length elements starting at first
+  SeqView(const T* first, int length) : first(first), length(length) {}
+
+  // Returns the number of elements in the view
+  int size() const {return length;}
+
+  // Tests if the view is empty
+  bool empty() const {return length == 0;}
+
+  // Returns the element at the index in the view. Throws
+  // out_of_range if index is invalid.
+  const T& operator[](int index) const
+  {
+    if (index < 0 || index >= length)
+      throw std::out_of_range("SeqView<T>::operator[](int index)");
+    return first[index];
+  }
+
+  // Raw pointer access and iterators over the viewed elements
+  const T* data() const {return first;}
+  const T* begin() const {return first;}
+  const T* end() const {return first + length;}
+
+private:
+
+  const T* first = nullptr;
+  int length = 0;
+};
+
+
+#endif
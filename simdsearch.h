@@ -0,0 +1,162 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: simdsearch.h
+// DATE: Fall 2021
+// DESC: Linear search kernel used by ArraySeq (and ArrayMap through
+//       it). For 32-bit and 64-bit integer elements on x86-64 the
+//       scan compares a whole vector of elements per instruction
+//       (AVX2 when the CPU supports it, otherwise SSE2), picked at
+//       runtime. Every other element type uses the scalar loop.
+//---------------------------------------------------------------------------
+
+#ifndef SIMDSEARCH_H
+#define SIMDSEARCH_H
+
+#include <type_traits>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMDSEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+
+//----------------------------------------------------------------------
+// Scalar version: returns the index of the first element equal to
+// elem in array[0..n), or -1 if there is no such element.
+//----------------------------------------------------------------------
+template<typename T>
+int scalar_find(const T* array, int n, const T& elem)
+{
+  for (int i = 0; i < n; ++i) {
+    if (array[i] == elem)
+      return i;
+  }
+  return -1;
+}
+
+
+#ifdef SIMDSEARCH_X86
+
+// returns true if the running CPU supports AVX2 (checked once)
+inline bool simd_has_avx2()
+{
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+// 32-bit elements, 4 per SSE2 compare (16 per loop iteration)
+inline int sse2_find32(const int32_t* array, int n, int32_t elem)
+{
+  const __m128i needle = _mm_set1_epi32(elem);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(array + i);
+    __m128i c0 = _mm_cmpeq_epi32(_mm_loadu_si128(p), needle);
+    __m128i c1 = _mm_cmpeq_epi32(_mm_loadu_si128(p + 1), needle);
+    __m128i c2 = _mm_cmpeq_epi32(_mm_loadu_si128(p + 2), needle);
+    __m128i c3 = _mm_cmpeq_epi32(_mm_loadu_si128(p + 3), needle);
+    __m128i any = _mm_or_si128(_mm_or_si128(c0, c1), _mm_or_si128(c2, c3));
+    if (_mm_movemask_epi8(any) != 0) {
+      // first match is in this block of 16
+      int bits = _mm_movemask_ps(_mm_castsi128_ps(c0))
+        | (_mm_movemask_ps(_mm_castsi128_ps(c1)) << 4)
+        | (_mm_movemask_ps(_mm_castsi128_ps(c2)) << 8)
+        | (_mm_movemask_ps(_mm_castsi128_ps(c3)) << 12);
+      return i + __builtin_ctz(bits);
+    }
+  }
+  int rest = scalar_find(array + i, n - i, elem);
+  return rest < 0 ? -1 : i + rest;
+}
+
+// 64-bit elements, 2 per SSE2 compare (8 per loop iteration). SSE2
+// has no 64-bit compare, so both 32-bit halves must match.
+inline int sse2_find64(const int64_t* array, int n, int64_t elem)
+{
+  const __m128i needle = _mm_set1_epi64x(elem);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(array + i);
+    int bits = 0;
+    for (int j = 0; j < 4; ++j) {
+      __m128i c = _mm_cmpeq_epi32(_mm_loadu_si128(p + j), needle);
+      c = _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+      bits |= _mm_movemask_pd(_mm_castsi128_pd(c)) << (2 * j);
+    }
+    if (bits != 0)
+      return i + __builtin_ctz(bits);
+  }
+  int rest = scalar_find(array + i, n - i, elem);
+  return rest < 0 ? -1 : i + rest;
+}
+
+// 32-bit elements, 8 per AVX2 compare (16 per loop iteration)
+__attribute__((target("avx2")))
+inline int avx2_find32(const int32_t* array, int n, int32_t elem)
+{
+  const __m256i needle = _mm256_set1_epi32(elem);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i* p = reinterpret_cast<const __m256i*>(array + i);
+    __m256i c0 = _mm256_cmpeq_epi32(_mm256_loadu_si256(p), needle);
+    __m256i c1 = _mm256_cmpeq_epi32(_mm256_loadu_si256(p + 1), needle);
+    int bits = _mm256_movemask_ps(_mm256_castsi256_ps(c0))
+      | (_mm256_movemask_ps(_mm256_castsi256_ps(c1)) << 8);
+    if (bits != 0)
+      return i + __builtin_ctz(bits);
+  }
+  int rest = scalar_find(array + i, n - i, elem);
+  return rest < 0 ? -1 : i + rest;
+}
+
+// 64-bit elements, 4 per AVX2 compare (8 per loop iteration)
+__attribute__((target("avx2")))
+inline int avx2_find64(const int64_t* array, int n, int64_t elem)
+{
+  const __m256i needle = _mm256_set1_epi64x(elem);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i* p = reinterpret_cast<const __m256i*>(array + i);
+    __m256i c0 = _mm256_cmpeq_epi64(_mm256_loadu_si256(p), needle);
+    __m256i c1 = _mm256_cmpeq_epi64(_mm256_loadu_si256(p + 1), needle);
+    int bits = _mm256_movemask_pd(_mm256_castsi256_pd(c0))
+      | (_mm256_movemask_pd(_mm256_castsi256_pd(c1)) << 4);
+    if (bits != 0)
+      return i + __builtin_ctz(bits);
+  }
+  int rest = scalar_find(array + i, n - i, elem);
+  return rest < 0 ? -1 : i + rest;
+}
+
+#endif
+
+
+//----------------------------------------------------------------------
+// Returns the index of the first element equal to elem in
+// array[0..n), or -1 if there is no such element. Integer elements
+// of 4 or 8 bytes are compared with SIMD instructions where
+// available; floating point and all other types use scalar_find
+// (bitwise equality is not == for them).
+//----------------------------------------------------------------------
+template<typename T>
+int linear_find(const T* array, int n, const T& elem)
+{
+#ifdef SIMDSEARCH_X86
+  if constexpr (std::is_integral<T>::value && sizeof(T) == 4) {
+    const int32_t* p = reinterpret_cast<const int32_t*>(array);
+    int32_t e = static_cast<int32_t>(elem);
+    return simd_has_avx2() ? avx2_find32(p, n, e) : sse2_find32(p, n, e);
+  }
+  else if constexpr (std::is_integral<T>::value && sizeof(T) == 8) {
+    const int64_t* p = reinterpret_cast<const int64_t*>(array);
+    int64_t e = static_cast<int64_t>(elem);
+    return simd_has_avx2() ? avx2_find64(p, n, e) : sse2_find64(p, n, e);
+  }
+  else
+#endif
+    return scalar_find(array, n, elem);
+}
+
+
+#endif
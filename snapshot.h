@@ -0,0 +1,414 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: snapshot.h
+// DATE: Fall 2021
+// DESC: Binary snapshots of sequences and maps with trivially
+//       copyable elements. A snapshot file is a fixed header followed
+//       by the raw key (or element) array and the raw value array,
+//       each starting on a 64-byte boundary. Map pairs are always
+//       written in ascending key order. Loading memory-maps the file
+//       and copies the arrays out in bulk, with no per-element
+//       parsing. SnapshotMap goes further and searches the mapped
+//       arrays in place, so opening one costs O(1) regardless of its
+//       size. Every function throws runtime_error if a file can't be
+//       read or written, or isn't a snapshot of the expected type.
+//---------------------------------------------------------------------------
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "map.h"
+#include "arrayseq.h"
+#include "seqview.h"
+#include "binsearchmap.h"
+
+
+// Bumped whenever the layout below changes; files with any other
+// version are rejected
+constexpr std::uint32_t snapshot_version = 1;
+
+// On-disk header (the first bytes of every snapshot file)
+struct SnapshotHeader {
+  char magic[8];                // "HW7SNAP" and a terminating zero
+  std::uint32_t version;        // snapshot_version
+  std::uint32_t byte_order;     // 0x01020304 as written by the saver
+  std::uint32_t kind;           // snapshot_sequence or snapshot_map
+  std::uint32_t key_size;       // sizeof(K), or sizeof(T) for a sequence
+  std::uint32_t value_size;     // sizeof(V), or 0 for a sequence
+  std::uint32_t reserved;
+  std::uint64_t count;          // number of elements or pairs
+  std::uint64_t keys_offset;    // file offset of the key array
+  std::uint64_t values_offset;  // file offset of the value array
+};
+
+constexpr std::uint32_t snapshot_sequence = 1;
+constexpr std::uint32_t snapshot_map = 2;
+
+// The key and value types of a map, deduced from its Map<K,V> base
+// (only used in decltype)
+template<typename K, typename V>
+std::pair<K,V> map_types(const Map<K,V>& map);
+
+
+// Read-only memory mapping of a whole file (unmapped on destruction)
+class MappedFile
+{
+public:
+
+  // Maps the file. Throws runtime_error if it can't be opened or
+  // mapped.
+  explicit MappedFile(const std::string& path);
+
+  MappedFile(const MappedFile& rhs) = delete;
+  MappedFile& operator=(const MappedFile& rhs) = delete;
+
+  // Move constructor
+  MappedFile(MappedFile&& rhs);
+
+  // Move assignment operator
+  MappedFile& operator=(MappedFile&& rhs);
+
+  // Destructor
+  ~MappedFile();
+
+  // Returns the mapped bytes
+  const char* data() const {return bytes;}
+
+  // Returns the number of mapped bytes
+  std::size_t size() const {return length;}
+
+private:
+
+  const char* bytes = nullptr;
+  std::size_t length = 0;
+
+  void unmap();
+};
+
+
+// Read-only sorted map served straight out of a mapped snapshot
+// file: opening is O(1), and lookups binary search the mapped keys.
+// The keys and values are never copied into memory of their own.
+template<typename K, typename V>
+class SnapshotMap
+{
+public:
+
+  // Maps the snapshot file (see load_snapshot for the errors)
+  explicit SnapshotMap(const std::string& path);
+
+  // Returns the number of key-value pairs in the map
+  int size() const {return count;}
+
+  // Tests if the map is empty
+  bool empty() const {return count == 0;}
+
+  // Returns the value for a given key. Throws out_of_range if the
+  // given key is not in the collection.
+  const V& operator[](const K& key) const;
+
+  // Returns a pointer to the value for the given key, or nullptr if
+  // the key is not in the collection
+  const V* find(const K& key) const noexcept;
+
+  // Returns true if the key is in the collection, and false
+  // otherwise
+  bool contains(const K& key) const {return find(key) != nullptr;}
+
+  // Returns views of the keys (in ascending order) and their values
+  SeqView<K> keys() const {return SeqView<K>(key_array, count);}
+  SeqView<V> values() const {return SeqView<V>(value_array, count);}
+
+private:
+
+  MappedFile file;
+  const K* key_array = nullptr;
+  const V* value_array = nullptr;
+  int count = 0;
+};
+
+
+//----------------------------------------------------------------------
+// Saving
+//----------------------------------------------------------------------
+
+// Helper that writes a header and the arrays to a file. The data goes
+// to path + ".tmp" first, which is then renamed over path, so a
+// failed save leaves the old snapshot in place and a SnapshotMap that
+// has the old file mapped keeps reading it.
+inline void write_snapshot(const std::string& path, std::uint32_t kind,
+                           std::uint32_t key_size, std::uint32_t value_size,
+                           const void* keys, const void* values, std::uint64_t count)
+{
+  // each array starts on a cache line (mmap itself is page aligned)
+  auto align = [](std::uint64_t offset) {return (offset + 63) / 64 * 64;};
+  SnapshotHeader header = {};
+  std::memcpy(header.magic, "HW7SNAP", 8);
+  header.version = snapshot_version;
+  header.byte_order = 0x01020304;
+  header.kind = kind;
+  header.key_size = key_size;
+  header.value_size = value_size;
+  header.count = count;
+  header.keys_offset = align(sizeof(SnapshotHeader));
+  header.values_offset = align(header.keys_offset + count * key_size);
+
+  std::string temp_path = path + ".tmp";
+  std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+  const char padding[64] = {};
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(padding, header.keys_offset - sizeof(header));
+  out.write(static_cast<const char*>(keys), count * key_size);
+  if (value_size > 0) {
+    out.write(padding, header.values_offset - (header.keys_offset + count * key_size));
+    out.write(static_cast<const char*>(values), count * value_size);
+  }
+  out.close();
+  if (!out) {
+    std::remove(temp_path.c_str());
+    throw std::runtime_error("write_snapshot(): can't write " + path);
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    throw std::runtime_error("write_snapshot(): can't replace " + path);
+  }
+}
+
+// Writes the sequence's elements to a snapshot file
+template<typename T, int N>
+void save_snapshot(const ArraySeq<T,N>& seq, const std::string& path)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "snapshots need trivially copyable elements");
+  write_snapshot(path, snapshot_sequence, sizeof(T), 0, seq.data(), nullptr, seq.size());
+}
+
+// Writes the map's pairs to a snapshot file in ascending key order
+// (works for any map with for_each)
+template<typename M>
+void save_snapshot(const M& map, const std::string& path)
+{
+  using K = typename decltype(map_types(map))::first_type;
+  using V = typename decltype(map_types(map))::second_type;
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                "snapshots need trivially copyable keys and values");
+  FlatSeq<K> keys;
+  FlatSeq<V> values;
+  keys.reserve(map.size());
+  values.reserve(map.size());
+  map.for_each([&](const K& key, const V& value){
+    keys.insert(key, keys.size());
+    values.insert(value, values.size());
+  });
+  if (!std::is_sorted(keys.begin(), keys.end())) {
+    // unordered maps (HashMap, ArrayMap): sort the pairs by key
+    FlatSeq<int> order;
+    order.reserve(keys.size());
+    for (int i = 0; i < keys.size(); ++i)
+      order.insert(i, i);
+    std::sort(order.begin(), order.end(), [&keys](int a, int b){
+      return keys.unchecked_at(a) < keys.unchecked_at(b);
+    });
+    FlatSeq<K> sorted_keys;
+    FlatSeq<V> sorted_values;
+    sorted_keys.reserve(keys.size());
+    sorted_values.reserve(values.size());
+    for (int i : order) {
+      sorted_keys.insert(keys.unchecked_at(i), sorted_keys.size());
+      sorted_values.insert(values.unchecked_at(i), sorted_values.size());
+    }
+    keys = std::move(sorted_keys);
+    values = std::move(sorted_values);
+  }
+  write_snapshot(path, snapshot_map, sizeof(K), sizeof(V),
+                 keys.data(), values.data(), keys.size());
+}
+
+
+//----------------------------------------------------------------------
+// Loading
+//----------------------------------------------------------------------
+
+// Helper that checks a mapped file holds a snapshot of the given kind
+// and element sizes, and returns its header
+inline const SnapshotHeader& check_snapshot(const MappedFile& file, const std::string& path,
+                                            std::uint32_t kind, std::uint32_t key_size,
+                                            std::uint32_t value_size)
+{
+  if (file.size() < sizeof(SnapshotHeader))
+    throw std::runtime_error("check_snapshot(): " + path + " is not a snapshot");
+  const SnapshotHeader& header = *reinterpret_cast<const SnapshotHeader*>(file.data());
+  if (std::memcmp(header.magic, "HW7SNAP", 8) != 0 || header.byte_order != 0x01020304)
+    throw std::runtime_error("check_snapshot(): " + path + " is not a snapshot");
+  if (header.version != snapshot_version)
+    throw std::runtime_error("check_snapshot(): " + path + " has an unsupported version");
+  if (header.kind != kind || header.key_size != key_size || header.value_size != value_size)
+    throw std::runtime_error("check_snapshot(): " + path + " holds a different type");
+  // an array of count elements of the given size fits at the offset
+  // (checked without any arithmetic that could wrap on bad offsets)
+  auto fits = [&file, &header](std::uint64_t offset, std::uint32_t elem_size) {
+    return offset >= sizeof(SnapshotHeader) && offset <= file.size() &&
+           header.count <= (file.size() - offset) / elem_size;
+  };
+  if (header.count > 0x7fffffff ||
+      header.keys_offset % 64 != 0 || header.values_offset % 64 != 0 ||
+      !fits(header.keys_offset, key_size) ||
+      (value_size > 0 && !fits(header.values_offset, value_size)))
+    throw std::runtime_error("check_snapshot(): " + path + " is truncated or corrupt");
+  return header;
+}
+
+// Replaces the sequence's elements with the snapshot's
+template<typename T, int N>
+void load_snapshot(const std::string& path, ArraySeq<T,N>& seq)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "snapshots need trivially copyable elements");
+  MappedFile file(path);
+  const SnapshotHeader& header = check_snapshot(file, path, snapshot_sequence, sizeof(T), 0);
+  ArraySeq<T,N> loaded;
+  loaded.append(reinterpret_cast<const T*>(file.data() + header.keys_offset), header.count);
+  seq = std::move(loaded);
+}
+
+// Replaces the map's pairs with the snapshot's. The pairs are already
+// sorted, so they are copied straight into the key and value arrays.
+template<typename K, typename V, template<typename> class Seq, typename Search>
+void load_snapshot(const std::string& path, BinSearchMap<K,V,Seq,Search>& map)
+{
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                "snapshots need trivially copyable keys and values");
+  MappedFile file(path);
+  const SnapshotHeader& header = check_snapshot(file, path, snapshot_map, sizeof(K), sizeof(V));
+  int count = header.count;
+  map.assign_sorted(SeqView<K>(reinterpret_cast<const K*>(file.data() + header.keys_offset), count),
+                    SeqView<V>(reinterpret_cast<const V*>(file.data() + header.values_offset), count));
+}
+
+// Replaces the map's pairs with the snapshot's in one insert_batch
+// (so a HashMap sizes its table once, and a BSTMap is built balanced)
+template<typename M>
+void load_snapshot(const std::string& path, M& map)
+{
+  using K = typename decltype(map_types(map))::first_type;
+  using V = typename decltype(map_types(map))::second_type;
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                "snapshots need trivially copyable keys and values");
+  MappedFile file(path);
+  const SnapshotHeader& header = check_snapshot(file, path, snapshot_map, sizeof(K), sizeof(V));
+  ArraySeq<K> keys;
+  ArraySeq<V> values;
+  keys.append(reinterpret_cast<const K*>(file.data() + header.keys_offset), header.count);
+  values.append(reinterpret_cast<const V*>(file.data() + header.values_offset), header.count);
+  M loaded;
+  loaded.insert_batch(keys, values);
+  map = std::move(loaded);
+}
+
+
+//----------------------------------------------------------------------
+// MappedFile
+//----------------------------------------------------------------------
+
+inline MappedFile::MappedFile(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("MappedFile(): can't open " + path);
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("MappedFile(): can't read " + path);
+  }
+  length = info.st_size;
+  if (length > 0) {
+    void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("MappedFile(): can't map " + path);
+    }
+    bytes = static_cast<const char*>(addr);
+  }
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+}
+
+inline MappedFile::MappedFile(MappedFile&& rhs)
+{
+  *this = std::move(rhs);
+}
+
+inline MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+  if (this != &rhs) {
+    unmap();
+    bytes = rhs.bytes;
+    length = rhs.length;
+    rhs.bytes = nullptr;
+    rhs.length = 0;
+  }
+  return *this;
+}
+
+inline MappedFile::~MappedFile()
+{
+  unmap();
+}
+
+inline void MappedFile::unmap()
+{
+  if (bytes != nullptr)
+    ::munmap(const_cast<char*>(bytes), length);
+  bytes = nullptr;
+  length = 0;
+}
+
+
+//----------------------------------------------------------------------
+// SnapshotMap
+//----------------------------------------------------------------------
+
+template<typename K, typename V>
+SnapshotMap<K,V>::SnapshotMap(const std::string& path)
+  : file(path)
+{
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                "snapshots need trivially copyable keys and values");
+  const SnapshotHeader& header = check_snapshot(file, path, snapshot_map, sizeof(K), sizeof(V));
+  key_array = reinterpret_cast<const K*>(file.data() + header.keys_offset);
+  value_array = reinterpret_cast<const V*>(file.data() + header.values_offset);
+  count = header.count;
+}
+
+template<typename K, typename V>
+const V& SnapshotMap<K,V>::operator[](const K& key) const
+{
+  const V* value = find(key);
+  if (value == nullptr)
+    throw std::out_of_range("SnapshotMap<K,V>::operator[](const K& key)");
+  return *value;
+}
+
+template<typename K, typename V>
+const V* SnapshotMap<K,V>::find(const K& key) const noexcept
+{
+  const K* it = std::lower_bound(key_array, key_array + count, key);
+  if (it == key_array + count || !(*it == key))
+    return nullptr;
+  return value_array + (it - key_array);
+}
+
+
+#endif
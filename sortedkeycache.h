@@ -0,0 +1,98 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: sortedkeycache.h
+// DATE: Fall 2021
+// DESC: Lazily built sorted copy of an unordered map's keys (used by
+//       HashMap and ArrayMap). The map invalidates the cache on every
+//       insert and erase. The next ordered query re-collects and
+//       sorts the keys once, in O(n log n). Every later query until
+//       the next write is served from the sorted copy:
+//       sorted_keys() is an O(n) copy, sorted_view() needs no copy,
+//       and find_keys() is O(log n + k). The keys, and the copies
+//       handed out, come from the map's memory resource.
+//---------------------------------------------------------------------------
+
+#ifndef SORTEDKEYCACHE_H
+#define SORTEDKEYCACHE_H
+
+#include <algorithm>
+#include <memory_resource>
+#include "arrayseq.h"
+#include "seqview.h"
+#include "memoryusage.h"
+
+
+template<typename K>
+class SortedKeyCache
+{
+public:
+
+  // Creates an empty cache that allocates from the given memory
+  // resource
+  explicit SortedKeyCache(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : keys(resource) {}
+
+  // Marks the cached keys out of date
+  void invalidate() {valid = false;}
+
+  // Brings the cache up to date. If it is out of date, collect(keys)
+  // must insert every key of the map (n of them) into keys, in any
+  // order.
+  template<typename F>
+  void update(int n, F collect){
+    if(valid){
+      return;
+    }
+    keys = FlatSeq<K>(keys.memory_resource());
+    keys.reserve(n);
+    collect(keys);
+    std::sort(keys.begin(), keys.end());
+    valid = true;
+  }
+
+  // Returns a copy of the keys (the cache must be up to date)
+  ArraySeq<K> all() const{
+    ArraySeq<K> keyList(keys.memory_resource());
+    keyList.reserve(keys.size());
+    for(const K& key : keys){
+      keyList.insert(key, keyList.size());
+    }
+    return keyList;
+  }
+
+  // Returns a copy of the keys k with k1 <= k <= k2 (the cache must
+  // be up to date)
+  ArraySeq<K> range(const K& k1, const K& k2) const{
+    ArraySeq<K> keyList(keys.memory_resource());
+    const K* first = std::lower_bound(keys.begin(), keys.end(), k1);
+    const K* last = std::upper_bound(first, keys.end(), k2);
+    keyList.reserve(last - first);
+    for(const K* p = first; p < last; ++p){
+      keyList.insert(*p, keyList.size());
+    }
+    return keyList;
+  }
+
+  // Returns a view of the keys (the cache must be up to date). The
+  // view is valid until the map is modified.
+  SeqView<K> view() const{
+    return SeqView<K>(keys.data(), keys.size());
+  }
+
+  // Returns the bytes the cache uses (see memoryusage.h), including
+  // the object itself
+  MemoryUsage memory_usage() const{
+    MemoryUsage usage = keys.memory_usage();
+    usage.metadata += sizeof(*this) - sizeof(keys);
+    return usage;
+  }
+
+private:
+
+  // the map's keys in ascending order, if valid
+  FlatSeq<K> keys;
+  bool valid = false;
+};
+
+
+#endif
@@ -0,0 +1,425 @@
+//---------------------------------------------------------------------------
+// NAME: Dominic MacIsaac
+// FILE: tieredseq.h
+// DATE: Fall 2021
+// DESC: Tiered vector implementation of Sequence. Elements are kept
+//       in an array of fixed-size blocks, each block a circular
+//       buffer of B elements (B a power of two, kept near sqrt(n)).
+//       Every block except the last is full, so element i is always
+//       in block i/B and indexing is O(1). Inserting or erasing
+//       shifts elements inside one block (O(B)) and then moves one
+//       element across each later block boundary (O(n/B)), for
+//       O(sqrt n) per operation instead of O(n).
+//---------------------------------------------------------------------------
+
+#ifndef TIEREDSEQ_H
+#define TIEREDSEQ_H
+
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include "sequence.h"
+#include "memoryusage.h"
+
+
+template<typename T>
+class TieredSeq final : public Sequence<T>
+{
+public:
+
+  // Default constructor
+  TieredSeq();
+
+  // Copy constructor
+  TieredSeq(const TieredSeq& rhs);
+
+  // Move constructor
+  TieredSeq(TieredSeq&& rhs);
+
+  // Copy assignment operator
+  TieredSeq& operator=(const TieredSeq& rhs);
+
+  // Move assignment operator
+  TieredSeq& operator=(TieredSeq&& rhs);
+
+  // Destructor
+  ~TieredSeq();
+
+  // Returns the number of elements in the sequence
+  int size() const;
+
+  // Tests if the sequence is empty
+  bool empty() const;
+
+  // Returns a reference to the element at the index in the
+  // sequence. Throws out_of_range if index is invalid.
+  T& operator[](int index);
+
+  // Returns a constant address to the element at the index in the
+  // sequence. Throws out_of_range if index is invalid.
+  const T& operator[](int index) const;
+
+  // Returns the element at the index without bounds checking. The
+  // index must be in [0, size()).
+  T& unchecked_at(int index);
+  const T& unchecked_at(int index) const;
+
+  // Extends the sequence by inserting the element at the given
+  // index. Throws out_of_range if the index is invalid.
+  void insert(const T& elem, int index);
+  void insert(T&& elem, int index);
+
+  // Shrinks the sequence by removing the element at the index in the
+  // sequence. Throws out_of_range if index is invalid.
+  void erase(int index);
+
+  // Returns true if the element is in the sequence, and false
+  // otherwise.
+  bool contains(const T& elem) const;
+
+  // Sorts the elements in the sequence using less than (<)
+  void sort();
+
+  // Returns the bytes the sequence uses (see memoryusage.h). The
+  // unused slots of the allocated blocks are slack, and the block and
+  // head arrays are metadata.
+  MemoryUsage memory_usage() const;
+
+private:
+
+  // smallest block size used (as a power of two)
+  static const int min_shift = 3;
+
+  // block b holds elements [b*B, (b+1)*B), stored circularly starting
+  // at blocks[b][heads[b]]
+  T** blocks = nullptr;
+  int* heads = nullptr;
+
+  // number of allocated blocks (the first ceil(count/B) are in use)
+  int block_count = 0;
+
+  // number of block slots in the blocks and heads arrays
+  int block_slots = 0;
+
+  // B = 1 << shift
+  int shift = min_shift;
+
+  // number of elements in the sequence
+  int count = 0;
+
+  int block_size() const{
+    return 1 << shift;
+  }
+
+  int mask() const{
+    return block_size() - 1;
+  }
+
+  // the slot in block b holding the block's j-th element
+  T& slot(int b, int j) const{
+    return blocks[b][(heads[b] + j) & mask()];
+  }
+
+  // helper for both inserts (copies or moves elem into place)
+  template<typename U>
+  void insert_elem(U&& elem, int index);
+
+  // helper to allocate one more block at the end
+  void add_block(){
+    if(block_count == block_slots){
+      int new_slots = block_slots == 0 ? 4 : block_slots * 2;
+      T** new_blocks = new T*[new_slots];
+      int* new_heads = new int[new_slots];
+      std::copy(blocks, blocks + block_count, new_blocks);
+      std::copy(heads, heads + block_count, new_heads);
+      delete [] blocks;
+      delete [] heads;
+      blocks = new_blocks;
+      heads = new_heads;
+      block_slots = new_slots;
+    }
+    blocks[block_count] = new T[block_size()];
+    heads[block_count] = 0;
+    ++block_count;
+  }
+
+  // helper to move every element into blocks of size 1 << new_shift
+  void rebuild(int new_shift){
+    int new_size = 1 << new_shift;
+    int new_count = (count + new_size - 1) / new_size;
+    int new_slots = std::max(4, new_count);
+    T** new_blocks = new T*[new_slots];
+    int* new_heads = new int[new_slots];
+    for(int b = 0; b < new_count; b++){
+      new_blocks[b] = new T[new_size];
+      new_heads[b] = 0;
+    }
+    for(int i = 0; i < count; i++){
+      new_blocks[i >> new_shift][i & (new_size - 1)] = std::move(unchecked_at(i));
+    }
+    make_empty_blocks();
+    blocks = new_blocks;
+    heads = new_heads;
+    block_count = new_count;
+    block_slots = new_slots;
+    shift = new_shift;
+  }
+
+  // helper to free all blocks (leaves count unchanged)
+  void make_empty_blocks(){
+    for(int b = 0; b < block_count; b++){
+      delete [] blocks[b];
+    }
+    delete [] blocks;
+    delete [] heads;
+    blocks = nullptr;
+    heads = nullptr;
+    block_count = 0;
+    block_slots = 0;
+  }
+
+  // helper to delete everything (called by destructor and
+  // assignment)
+  void make_empty(){
+    make_empty_blocks();
+    count = 0;
+    shift = min_shift;
+  }
+};
+
+
+template<typename T>
+TieredSeq<T>::TieredSeq()
+{
+  return;
+}
+
+template<typename T>
+TieredSeq<T>::TieredSeq(const TieredSeq& rhs)
+{
+  *this = rhs;
+}
+
+template<typename T>
+TieredSeq<T>::TieredSeq(TieredSeq&& rhs)
+{
+  *this = std::move(rhs);
+}
+
+template<typename T>
+TieredSeq<T>& TieredSeq<T>::operator=(const TieredSeq& rhs)
+{
+  if(this != &rhs){
+    make_empty();
+    shift = rhs.shift;
+    for(int b = 0; b < rhs.block_count; b++){
+      add_block();
+    }
+    count = rhs.count;
+    for(int i = 0; i < count; i++){
+      unchecked_at(i) = rhs.unchecked_at(i);
+    }
+  }
+  return *this;
+}
+
+template<typename T>
+TieredSeq<T>& TieredSeq<T>::operator=(TieredSeq&& rhs)
+{
+  if(this != &rhs){
+    make_empty();
+    blocks = rhs.blocks;
+    heads = rhs.heads;
+    block_count = rhs.block_count;
+    block_slots = rhs.block_slots;
+    shift = rhs.shift;
+    count = rhs.count;
+    rhs.blocks = nullptr;
+    rhs.heads = nullptr;
+    rhs.block_count = 0;
+    rhs.make_empty();
+  }
+  return *this;
+}
+
+template<typename T>
+TieredSeq<T>::~TieredSeq()
+{
+  make_empty();
+}
+
+template<typename T>
+int TieredSeq<T>::size() const
+{
+  return count;
+}
+
+template<typename T>
+bool TieredSeq<T>::empty() const
+{
+  return count == 0;
+}
+
+template<typename T>
+T& TieredSeq<T>::operator[](int index)
+{
+  if(index < 0 || index >= count){
+    throw std::out_of_range("TieredSeq<T>::operator[](int index)");
+  }
+  return unchecked_at(index);
+}
+
+template<typename T>
+const T& TieredSeq<T>::operator[](int index) const
+{
+  if(index < 0 || index >= count){
+    throw std::out_of_range("TieredSeq<T>::operator[](int index)");
+  }
+  return unchecked_at(index);
+}
+
+template<typename T>
+T& TieredSeq<T>::unchecked_at(int index)
+{
+  return slot(index >> shift, index & mask());
+}
+
+template<typename T>
+const T& TieredSeq<T>::unchecked_at(int index) const
+{
+  return slot(index >> shift, index & mask());
+}
+
+template<typename T>
+void TieredSeq<T>::insert(const T& elem, int index)
+{
+  insert_elem(elem, index);
+}
+
+template<typename T>
+void TieredSeq<T>::insert(T&& elem, int index)
+{
+  insert_elem(std::move(elem), index);
+}
+
+template<typename T>
+template<typename U>
+void TieredSeq<T>::insert_elem(U&& elem, int index)
+{
+  if(index < 0 || index > count){
+    throw std::out_of_range("TieredSeq<T>::insert(const T& elem, int index)");
+  }
+  // keep B near sqrt(n): grow once there would be more than B blocks
+  if(count + 1 > block_size() * block_size()){
+    rebuild(shift + 1);
+  }
+  const int bsize = block_size();
+  if(count == block_count * bsize){
+    add_block();
+  }
+
+  // make room in block b by moving the last element of each full
+  // block from b up to the front of the block after it
+  int b = index >> shift;
+  int last = count >> shift;
+  for(int k = last; k > b; k--){
+    heads[k] = (heads[k] - 1) & mask();
+    blocks[k][heads[k]] = std::move(slot(k - 1, bsize - 1));
+  }
+
+  // insert into block b, shifting whichever side is shorter
+  int used = (b == last) ? (count & mask()) : bsize - 1;
+  int offset = index & mask();
+  if(offset < used / 2){
+    heads[b] = (heads[b] - 1) & mask();
+    for(int j = 0; j < offset; j++){
+      slot(b, j) = std::move(slot(b, j + 1));
+    }
+  }
+  else {
+    for(int j = used; j > offset; j--){
+      slot(b, j) = std::move(slot(b, j - 1));
+    }
+  }
+  slot(b, offset) = std::forward<U>(elem);
+  ++count;
+}
+
+template<typename T>
+void TieredSeq<T>::erase(int index)
+{
+  if(index < 0 || index >= count){
+    throw std::out_of_range("TieredSeq<T>::erase(int index)");
+  }
+  const int bsize = block_size();
+  int b = index >> shift;
+  int last = (count - 1) >> shift;
+  int used = (b == last) ? count - (b << shift) : bsize;
+  int offset = index & mask();
+
+  // close the gap in block b, shifting whichever side is shorter
+  if(offset < used / 2){
+    for(int j = offset; j > 0; j--){
+      slot(b, j) = std::move(slot(b, j - 1));
+    }
+    heads[b] = (heads[b] + 1) & mask();
+  }
+  else {
+    for(int j = offset; j < used - 1; j++){
+      slot(b, j) = std::move(slot(b, j + 1));
+    }
+  }
+
+  // pull the first element of each later block back into the
+  // block before it
+  for(int k = b + 1; k <= last; k++){
+    slot(k - 1, bsize - 1) = std::move(slot(k, 0));
+    heads[k] = (heads[k] + 1) & mask();
+  }
+  --count;
+
+  // shrink B once the blocks are mostly unused
+  if(shift > min_shift && count < (bsize * bsize) / 16){
+    rebuild(shift - 1);
+  }
+}
+
+template<typename T>
+bool TieredSeq<T>::contains(const T& elem) const
+{
+  for(int i = 0; i < count; i++){
+    if(unchecked_at(i) == elem){
+      return true;
+    }
+  }
+  return false;
+}
+
+template<typename T>
+void TieredSeq<T>::sort()
+{
+  if(count < 2){
+    return;
+  }
+  T* temp = new T[count];
+  for(int i = 0; i < count; i++){
+    temp[i] = std::move(unchecked_at(i));
+  }
+  std::sort(temp, temp + count);
+  for(int i = 0; i < count; i++){
+    unchecked_at(i) = std::move(temp[i]);
+  }
+  delete [] temp;
+}
+
+template<typename T>
+MemoryUsage TieredSeq<T>::memory_usage() const{
+  MemoryUsage usage;
+  usage.payload = (long) count * sizeof(T);
+  usage.slack = ((long) block_count * block_size() - count) * sizeof(T);
+  usage.metadata = sizeof(*this) + (long) block_slots * (sizeof(T*) + sizeof(int));
+  return usage;
+}
+
+
+#endif
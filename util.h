@@ -2,17 +2,23 @@
 // NAME: S. Bowers
 // FILE: util.h
 // DATE: Fall 2021
-// DESC: Helper functions for running performance tests.
+// DESC: Helper functions for running performance tests. Each helper
+//       is a template over the sequence type: passing a concrete
+//       (final) sequence such as ArraySeq<int> gives statically
+//       dispatched element access, while passing a Sequence<int>&
+//       uses the virtual interface (that instantiation is compiled
+//       once, in util.cpp).
 //---------------------------------------------------------------------------
 
 #ifndef UTIL_H
 #define UTIL_H
 
 #include "sequence.h"
+#include "arrayseq.h"
 
 //----------------------------------------------------------------------
 // Performs a given number of "faro" shuffles for the given
-// sequence. Faro shuffles are useful for our performance tests since
+// sequence of ints. Faro shuffles are useful for our performance tests since
 // they are deterministic. Assumes the sequence is loaded with data to
 // shuffle.
 //
@@ -23,7 +29,14 @@
 // Outputs:
 //   s        -- the sequence is shuffled
 //----------------------------------------------------------------------
-void faro_shuffle(Sequence<int>& s, int shuffles);
+template<typename Seq>
+void faro_shuffle(Seq& s, int shuffles);
+
+//----------------------------------------------------------------------
+// Same as above, but shuffles the ArraySeq's underlying array
+// directly (no virtual calls or bounds checks per element).
+//----------------------------------------------------------------------
+void faro_shuffle(ArraySeq<int>& s, int shuffles);
 
 
 //----------------------------------------------------------------------
@@ -38,7 +51,8 @@ void faro_shuffle(Sequence<int>& s, int shuffles);
 // Outputs:
 //   s        -- the sequence is loaded with shuffled data
 //----------------------------------------------------------------------
-void load_shuffled(Sequence<int>& s, int n, int shuffles);
+template<typename Seq>
+void load_shuffled(Seq& s, int n, int shuffles);
 
 
 //----------------------------------------------------------------------
@@ -52,7 +66,8 @@ void load_shuffled(Sequence<int>& s, int n, int shuffles);
 // Outputs:
 //   s -- the sequence is loaded with data (values from 1 to n)
 //----------------------------------------------------------------------
-void load_in_order(Sequence<int>& s, int n);
+template<typename Seq>
+void load_in_order(Seq& s, int n);
 
 
 //----------------------------------------------------------------------
@@ -66,7 +81,8 @@ void load_in_order(Sequence<int>& s, int n);
 // Outputs:
 //   s -- the sequence is loaded with data (values from n to 1)
 //----------------------------------------------------------------------
-void load_reverse_order(Sequence<int>& s, int n);
+template<typename Seq>
+void load_reverse_order(Seq& s, int n);
 
 //----------------------------------------------------------------------
 // Reset the sequence with the values 1 to n. Assumes the sequence is
@@ -78,7 +94,8 @@ void load_reverse_order(Sequence<int>& s, int n);
 // Outputs:
 //   s -- the sequence values are reset
 //----------------------------------------------------------------------
-void reset_ordered(Sequence<int>& s);
+template<typename Seq>
+void reset_ordered(Seq& s);
 
 //----------------------------------------------------------------------
 // Reset the sequence with the values n to 1. Assumes the sequence is
@@ -90,7 +107,8 @@ void reset_ordered(Sequence<int>& s);
 // Outputs:
 //   s -- the sequence values are reset
 //----------------------------------------------------------------------
-void reset_reversed(Sequence<int>& s);
+template<typename Seq>
+void reset_reversed(Seq& s);
 
 
 //----------------------------------------------------------------------
@@ -103,6 +121,90 @@ void reset_reversed(Sequence<int>& s);
 // Outputs:
 //   s -- the sequence values are reset
 //----------------------------------------------------------------------
-void reset_shuffled(Sequence<int>& s, int shuffles);
+template<typename Seq>
+void reset_shuffled(Seq& s, int shuffles);
+
+
+//----------------------------------------------------------------------
+// Template definitions
+//----------------------------------------------------------------------
+
+template<typename Seq>
+void faro_shuffle(Seq& seq, int shuffles)
+{
+  static_assert(is_sequence_of<Seq,int>, "faro_shuffle requires a Sequence<int>");
+  int n = seq.size();
+  int* tmp_array = new int[n];
+  bool out_shuffle = true;
+  
+  for (int s = 0; s < shuffles; ++s) {
+    for (int i = 0; i < n/2; ++i) {    
+      int j = n/2 + i;
+      int index = 2*i;
+      tmp_array[index] = out_shuffle ? seq[i] : seq[j];
+      tmp_array[index + 1] = out_shuffle ? seq[j] : seq[i];
+    }
+    for (int i = 0; i < 2*(n/2); ++i)
+      seq[i] = tmp_array[i];
+    out_shuffle = !out_shuffle;
+  }
+  delete [] tmp_array;
+}
+
+template<typename Seq>
+void load_shuffled(Seq& s, int n, int shuffles)
+{
+  load_in_order(s, n);
+  faro_shuffle(s, shuffles);
+}
+
+template<typename Seq>
+void load_in_order(Seq& s, int n)
+{
+  static_assert(is_sequence_of<Seq,int>, "load_in_order requires a Sequence<int>");
+  for (int i = 0; i < n; ++i)
+    s.insert(i+1, i);
+}
+
+template<typename Seq>
+void load_reverse_order(Seq& s, int n)
+{
+  static_assert(is_sequence_of<Seq,int>, "load_reverse_order requires a Sequence<int>");
+  for (int i = 0; i < n; ++i)
+    s.insert(n-i, i);
+}
+
+template<typename Seq>
+void reset_ordered(Seq& s)
+{
+  static_assert(is_sequence_of<Seq,int>, "reset_ordered requires a Sequence<int>");
+  int n = s.size();
+  for (int i = 0; i < n; ++i)
+    s[i] = i + 1;
+}
+
+template<typename Seq>
+void reset_reversed(Seq& s)
+{
+  static_assert(is_sequence_of<Seq,int>, "reset_reversed requires a Sequence<int>");
+  int n = s.size();
+  for (int i = 0; i < n; ++i)
+    s[i] = n - i;
+}
+
+template<typename Seq>
+void reset_shuffled(Seq& s, int shuffles)
+{
+  faro_shuffle(s, shuffles);
+}
+
+// the virtual-interface versions are instantiated in util.cpp
+extern template void faro_shuffle(Sequence<int>&, int);
+extern template void load_shuffled(Sequence<int>&, int, int);
+extern template void load_in_order(Sequence<int>&, int);
+extern template void load_reverse_order(Sequence<int>&, int);
+extern template void reset_ordered(Sequence<int>&);
+extern template void reset_reversed(Sequence<int>&);
+extern template void reset_shuffled(Sequence<int>&, int);
 
 #endif